@@ -86,6 +86,8 @@ void setup() {
     Serial.println("Failed to start MDNS responder!");
     while(1);
   }
+  // Let DNS-SD browsers find the web server.
+  mdnsResponder.addService("http", "tcp", 80);
 
   Serial.print("Server listening at http://");
   Serial.print(mdnsName);
@@ -34,17 +34,62 @@
 #endif
 
 #include "utility/WiFiSocket.h"
+#include "utility/WiFiLed.h"
 
 #include "WiFi101.h"
 
+#ifndef LIMITED_RAM_DEVICE
+#include "WiFiMDNS.h"
+#endif
+
 extern "C" {
   #include "bsp/include/nm_bsp.h"
   #include "bsp/include/nm_bsp_arduino.h"
   #include "driver/include/m2m_periph.h"
   #include "driver/include/m2m_ssl.h"
   #include "driver/include/m2m_wifi.h"
+  #include "driver/source/m2m_hif.h"
+  #include "driver/source/nmasic.h"
 }
 
+#define SCAN_RSSI_THRESH -45
+#define SCAN_CHANNEL_MASK (WL_SCAN_CHANNEL(M2M_WIFI_CH_14 + 1) - 1)
+
+enum {
+	RECONNECT_OFF,
+	RECONNECT_ARMED,
+	RECONNECT_CONNECTING,
+	RECONNECT_WAITING
+};
+
+#define ROAM_RSSI_MARGIN 8
+
+enum {
+	ROAM_IDLE,
+	ROAM_SCANNING,
+	ROAM_LEAVING,
+	ROAM_JOINING
+};
+
+enum {
+	INIT_IDLE,
+	INIT_RESET,
+	INIT_SETTLE,
+	INIT_BOOT
+};
+
+enum {
+	SCAN_STATE_IDLE,
+	SCAN_STATE_RUNNING,
+	SCAN_STATE_DONE
+};
+
+enum {
+	SCAN_INTERNAL_NONE,
+	SCAN_INTERNAL_ROAM,
+	SCAN_INTERNAL_CHANNEL
+};
+
 static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 {
 	WiFi.handleEvent(u8MsgType, pvMsg);
@@ -52,6 +97,8 @@ static void wifi_cb(uint8_t u8MsgType, void *pvMsg)
 
 void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 {
+	uint8_t previous = _status;
+
 	switch (u8MsgType) {
 		case M2M_WIFI_RESP_DEFAULT_CONNECT:
 		{
@@ -67,9 +114,24 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 			tstrM2mWifiStateChanged *pstrWifiState = (tstrM2mWifiStateChanged *)pvMsg;
 			if (pstrWifiState->u8CurrState == M2M_WIFI_CONNECTED) {
 				//SERIAL_PORT_MONITOR.println("wifi_cb: M2M_WIFI_RESP_CON_STATE_CHANGED: CONNECTED");
-				if (_mode == WL_STA_MODE && !_dhcp) {
+				// Fill the connection info cache:
+				m2m_wifi_get_connection_info();
+				// the channel for fast reconnect, unless a scan already has it
+				_learnChannel = (_mode == WL_STA_MODE);
+
+				if (_roamState == ROAM_LEAVING || _roamState == ROAM_JOINING) {
+					_roamState = ROAM_IDLE;
+				}
+
+				if (_mode == WL_STA_MODE && (!_dhcp || _leaseReused)) {
 					_status = WL_CONNECTED;
 
+					if (_leaseReused) {
+						// Revalidate the reused lease in the background
+						m2m_wifi_enable_dhcp(1);
+						_leaseReused = false;
+					}
+
 #ifdef CONF_PERIPH
 					// WiFi led ON.
 					m2m_periph_gpio_set_val(M2M_PERIPH_GPIO15, 0);
@@ -79,7 +141,27 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 				}
 			} else if (pstrWifiState->u8CurrState == M2M_WIFI_DISCONNECTED) {
 				//SERIAL_PORT_MONITOR.println("wifi_cb: M2M_WIFI_RESP_CON_STATE_CHANGED: DISCONNECTED");
+				_connInfoValid = false;
+				_rssiValid = false;
+				if (_roamState == ROAM_LEAVING) {
+					// Left the old AP on purpose, keep sockets and status
+					_roamState = ROAM_JOINING;
+					break;
+				} else if (_roamState == ROAM_JOINING) {
+					// The new AP did not take us, give up and reconnect normally
+					resetFastReconnect();
+				}
+				_roamState = ROAM_IDLE;
+
 				if (_mode == WL_STA_MODE) {
+					if (previous != WL_CONNECTED && _connectChannel != M2M_WIFI_CH_ALL) {
+						// Fast reconnect failed, next attempt takes the full path
+						resetFastReconnect();
+					}
+					if (_reconnectState != RECONNECT_OFF) {
+						scheduleReconnect();
+					}
+
 					_status = WL_DISCONNECTED;
 					if (_dhcp) {
 						_localip = 0;
@@ -107,6 +189,8 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 		{
 			if (_mode == WL_STA_MODE) {
 				tstrM2MIPConfig *pstrIPCfg = (tstrM2MIPConfig *)pvMsg;
+				memcpy(&_lease, pstrIPCfg, sizeof(tstrM2MIPConfig));
+				_leaseTime = millis();
 				_localip = pstrIPCfg->u32StaticIP;
 				_submask = pstrIPCfg->u32SubnetMask;
 				_gateway = pstrIPCfg->u32Gateway;
@@ -134,7 +218,9 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 
 		case M2M_WIFI_RESP_CURRENT_RSSI:
 		{
-			_resolve = *((int8_t *)pvMsg);
+			_rssi = *((int8_t *)pvMsg);
+			_rssiValid = true;
+			_rssiPending = false;
 		}
 		break;
 
@@ -163,7 +249,26 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 		case M2M_WIFI_RESP_SCAN_DONE:
 		{
 			tstrM2mScanDone *pstrInfo = (tstrM2mScanDone *)pvMsg;
-			if (pstrInfo->u8NumofCh >= 1) {
+			if (_scanState == SCAN_STATE_RUNNING) {
+				uint8_t size = _scanCount + pstrInfo->u8NumofCh;
+
+				if (size > WIFI_SCAN_RESULTS_MAX) {
+					size = WIFI_SCAN_RESULTS_MAX;
+				}
+
+				if (size > _scanSize) {
+					wl_scan_result_t *results = (wl_scan_result_t *)realloc(_scanResults, size * sizeof(wl_scan_result_t));
+
+					if (results) {
+						_scanResults = results;
+						_scanSize = size;
+					}
+				}
+
+				_scanFetchPos = 0;
+				_scanFetchCount = pstrInfo->u8NumofCh;
+				continueScan();
+			} else if (pstrInfo->u8NumofCh >= 1) {
 				_status = WL_SCAN_COMPLETED;
 			}
 		}
@@ -172,21 +277,29 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 		case M2M_WIFI_RESP_SCAN_RESULT:
 		{
 			tstrM2mWifiscanResult *pstrScanResult = (tstrM2mWifiscanResult *)pvMsg;
-			uint16_t scan_ssid_len = strlen((const char *)pstrScanResult->au8SSID);
-			memset(_scan_ssid, 0, M2M_MAX_SSID_LEN);
-			if (scan_ssid_len) {
-				memcpy(_scan_ssid, (const char *)pstrScanResult->au8SSID, scan_ssid_len);
-			}
-			if (_remoteMacAddress) {
+			if (_scanResults && _scanCount < _scanSize) {
+				wl_scan_result_t *result = &_scanResults[_scanCount++];
+
+				memset(result->ssid, 0, M2M_MAX_SSID_LEN);
+				strncpy(result->ssid, (const char *)pstrScanResult->au8SSID, M2M_MAX_SSID_LEN - 1);
 				// reverse copy the remote MAC
 				for(int i = 0; i < 6; i++) {
-					_remoteMacAddress[i] = pstrScanResult->au8BSSID[5-i];
+					result->bssid[i] = pstrScanResult->au8BSSID[5-i];
+				}
+				result->rssi = pstrScanResult->s8rssi;
+				result->auth = pstrScanResult->u8AuthType;
+				result->channel = pstrScanResult->u8ch;
+
+				if (_scanState == SCAN_STATE_RUNNING && _scanCallback) {
+					_scanCallback(result);
 				}
 			}
-			_resolve = pstrScanResult->s8rssi;
-			_scan_auth = pstrScanResult->u8AuthType;
-			_scan_channel = pstrScanResult->u8ch;
-			_status = WL_SCAN_COMPLETED;
+
+			if (_scanState == SCAN_STATE_RUNNING) {
+				continueScan();
+			} else {
+				_status = WL_SCAN_COMPLETED;
+			}
 		}
 		break;
 
@@ -194,12 +307,21 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 		{
 			tstrM2MConnInfo	*pstrConnInfo = (tstrM2MConnInfo*)pvMsg;
 
-			if (_remoteMacAddress) {
-				// reverse copy the remote MAC
-				for(int i = 0; i < 6; i++) {
-					_remoteMacAddress[i] = pstrConnInfo->au8MACAddress[5-i];
-				}
-				_remoteMacAddress = 0;
+			// reverse copy the remote MAC
+			for(int i = 0; i < 6; i++) {
+				_remoteMacAddress[i] = pstrConnInfo->au8MACAddress[5-i];
+			}
+			_encryption = pstrConnInfo->u8SecType;
+			_connInfoValid = true;
+
+			if (_mode == WL_STA_MODE) {
+				learnChannel();
+			}
+
+			if (!_rssiPending) {
+				_rssi = pstrConnInfo->s8RSSI;
+				_rssiValid = true;
+				_rssiTime = millis();
 			}
 
 			strcpy((char *)_ssid, pstrConnInfo->acSSID);
@@ -219,6 +341,20 @@ void WiFiClass::handleEvent(uint8_t u8MsgType, void *pvMsg)
 		default:
 		break;
 	}
+
+	// Scans borrow _status while they wait, so only report connection changes:
+	if (u8MsgType != M2M_WIFI_RESP_SCAN_DONE && u8MsgType != M2M_WIFI_RESP_SCAN_RESULT && _status != _reportedStatus) {
+		_reportedStatus = _status;
+
+		if (_status == WL_CONNECTED && _reconnectState != RECONNECT_OFF) {
+			_reconnectState = RECONNECT_ARMED;
+			_reconnectAttempts = 0;
+		}
+
+		if (_statusCallback) {
+			_statusCallback(_status);
+		}
+	}
 }
 
 static void resolve_cb(uint8_t * hostName, uint32_t hostIp)
@@ -231,6 +367,18 @@ void WiFiClass::handleResolve(uint8_t * /*hostName*/, uint32_t hostIp)
 	_resolve = hostIp;
 }
 
+static void mon_cb(tstrM2MWifiRxPacketInfo *pstrWifiRxPacket, uint8 *pu8Payload, uint16 u16PayloadSize)
+{
+	WiFi.handleMonitor(pstrWifiRxPacket, pu8Payload, u16PayloadSize);
+}
+
+void WiFiClass::handleMonitor(tstrM2MWifiRxPacketInfo *info, uint8_t *payload, uint16_t size)
+{
+	if (_monCb) {
+		_monCb(info, payload, size);
+	}
+}
+
 static void socket_cb(SOCKET sock, uint8 u8Msg, void *pvMsg)
 {
 	WiFiSocket.eventCallback(sock, u8Msg, pvMsg);
@@ -262,8 +410,47 @@ void WiFiClass::handlePingResponse(uint32 u32IPAddr, uint32 u32RTT, uint8 u8Erro
 
 WiFiClass::WiFiClass() :
   _init(0),
+  _macValid(false),
+  _initState(INIT_IDLE),
+#ifdef ETH_MODE
+  _ethParam(NULL),
+#endif
+  _monCb(NULL),
+  _connInfoValid(false),
+  _rssiValid(false),
+  _rssiPending(false),
+  _rssiInterval(1000),
+  _fastReconnect(false),
+  _learnChannel(false),
+  _reuseLease(false),
+  _leaseReused(false),
+  _reconnectChannel(0),
+  _connectChannel(M2M_WIFI_CH_ALL),
+  _connectSecType(M2M_WIFI_SEC_INVALID),
+  _autoReconnect(false),
+  _reconnectState(RECONNECT_OFF),
+  _reconnectSeeded(false),
+  _backoffMin(500),
+  _backoffMax(30000),
+  _statusCallback(NULL),
+  _reportedStatus(WL_NO_SHIELD),
+  _roamEnabled(false),
+  _roamState(ROAM_IDLE),
+  _psAdaptive(false),
+  _psMode(M2M_NO_PS),
+  _networkCount(0),
+  _lastNetwork(-1),
   _mode(WL_RESET_MODE),
   _status(WL_NO_SHIELD),
+  _scanResults(NULL),
+  _scanSize(0),
+  _scanCount(0),
+  _scanState(SCAN_STATE_IDLE),
+  _scanSsidList(NULL),
+  _scanCallback(NULL),
+  _scanBlocking(false),
+  _scanInternal(SCAN_INTERNAL_NONE),
+  _userScanResults(NULL),
   _timeout(60000)
 {
 }
@@ -281,12 +468,116 @@ int WiFiClass::init()
 	tstrWifiInitParam param;
 	int8_t ret;
 
+	if (_initState != INIT_IDLE) {
+		// Finish the boot started by initStart()
+		while ((ret = initPoll()) == 1);
+		return ret;
+	}
+
+	_initStart = nm_bsp_time_us();
+	memset(&_bootTime, 0, sizeof(_bootTime));
+	_version[0] = 0;
+	_macValid = false;
+
 	// Initialize the WiFi BSP:
 	nm_bsp_init();
+	_bootTime.reset = nm_bsp_time_us() - _initStart;
 
 	// Initialize WiFi module and register status callback:
-	param.pfAppWifiCb = wifi_cb;
+	initParams(&param);
 	ret = m2m_wifi_init(&param);
+	return initDone(ret);
+}
+
+void WiFiClass::initStart()
+{
+	if (_init || _initState != INIT_IDLE) {
+		return;
+	}
+
+	_initStart = nm_bsp_time_us();
+	memset(&_bootTime, 0, sizeof(_bootTime));
+	_version[0] = 0;
+	_macValid = false;
+
+	// Hold the module in reset, initPoll() releases it
+	nm_bsp_init_async();
+	_initState = INIT_RESET;
+	_initTime = millis();
+}
+
+int WiFiClass::initPoll()
+{
+	tstrWifiInitParam param;
+	unsigned long now = millis();
+	int8_t ret;
+
+	switch (_initState) {
+		case INIT_IDLE:
+			if (_init) {
+				return M2M_SUCCESS;
+			}
+			initStart();
+			return 1;
+
+		case INIT_RESET:
+			if (now - _initTime < (gu8Winc1501FastBoot ? WINC1501_FAST_RESET_LOW_MS : WINC1501_RESET_LOW_MS)) {
+				return 1;
+			}
+			nm_bsp_reset_release();
+			_initState = INIT_SETTLE;
+			_initTime = now;
+			return 1;
+
+		case INIT_SETTLE:
+			if (now - _initTime < (gu8Winc1501FastBoot ? WINC1501_FAST_RESET_WAIT_MS : WINC1501_RESET_WAIT_MS)) {
+				return 1;
+			}
+			_bootTime.reset = nm_bsp_time_us() - _initStart;
+
+			initParams(&param);
+			ret = m2m_wifi_init_start(&param);
+			if (M2M_SUCCESS != ret) {
+				_initState = INIT_IDLE;
+				return initDone(ret);
+			}
+			_initState = INIT_BOOT;
+			_initTime = now;
+			return 1;
+
+		case INIT_BOOT:
+			// Same spacing as the blocking boot, the bus errors on faster polls
+			if (now - _initTime < 2) {
+				return 1;
+			}
+			_initTime = now;
+			ret = m2m_wifi_init_poll();
+			if (M2M_NOT_YET == ret) {
+				return 1;
+			}
+			_initState = INIT_IDLE;
+			return initDone(ret);
+	}
+
+	return 1;
+}
+
+void WiFiClass::initParams(tstrWifiInitParam *param)
+{
+	memset(param, 0, sizeof(tstrWifiInitParam));
+	param->pfAppWifiCb = wifi_cb;
+	param->pfAppMonCb = mon_cb;
+#ifdef ETH_MODE
+	if (_ethParam) {
+		param->strEthInitParam = *_ethParam;
+	}
+#endif
+}
+
+int WiFiClass::initDone(int8_t ret)
+{
+	chip_get_boot_times(&_bootTime.bootrom, &_bootTime.firmware);
+	_bootTime.total = nm_bsp_time_us() - _initStart;
 	if (M2M_SUCCESS != ret && M2M_ERR_FW_VER_MISMATCH != ret) {
 #ifdef CONF_PERIPH
 		if (ret != M2M_ERR_INVALID) {
@@ -307,8 +598,20 @@ int WiFiClass::init()
 	_submask = 0;
 	_gateway = 0;
 	_dhcp = 1;
+#ifdef ETH_MODE
+	if (_ethParam) {
+		// DHCP is up to the host stack, the link is reported as connected
+		_dhcp = 0;
+	}
+#endif
 	_resolve = 0;
-	_remoteMacAddress = 0;
+	_lease.u32StaticIP = 0;
+	_psMode = M2M_NO_PS;
+	_psSince = millis();
+	memset(_psTime, 0, sizeof(_psTime));
+	_connInfoValid = false;
+	_rssiValid = false;
+	_rssiPending = false;
 
 	extern uint32 nmdrv_firm_ver;
 
@@ -331,6 +634,7 @@ int WiFiClass::init()
 	m2m_periph_gpio_set_dir(M2M_PERIPH_GPIO4, 1);
 	m2m_periph_gpio_set_dir(M2M_PERIPH_GPIO5, 1);
 	m2m_periph_gpio_set_dir(M2M_PERIPH_GPIO6, 1);
+	WiFiLed.begin();
 #endif
 
 	return ret;
@@ -347,6 +651,9 @@ char* WiFiClass::firmwareVersion()
 	if (!_init) {
 		init();
 	}
+	if (_version[0]) {
+		return _version;
+	}
 	nm_get_firmware_info(&rev);
 	memset(_version, 0, 9);
 	if (rev.u8FirmwareMajor != rev.u8DriverMajor && rev.u8FirmwareMinor != rev.u8DriverMinor) {
@@ -420,125 +727,463 @@ uint8_t WiFiClass::begin(const char *ssid, const char *key)
 	return startConnect(ssid, M2M_WIFI_SEC_WPA_PSK, key);
 }
 
-uint8_t WiFiClass::startConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo)
+uint8_t WiFiClass::beginAsync(const char *ssid)
+{
+	return startConnectAsync(ssid, M2M_WIFI_SEC_OPEN, (void *)0);
+}
+
+uint8_t WiFiClass::beginAsync(const char *ssid, uint8_t key_idx, const char* key)
+{
+	tstrM2mWifiWepParams wep_params;
+
+	memset(&wep_params, 0, sizeof(tstrM2mWifiWepParams));
+	wep_params.u8KeyIndx = key_idx;
+	wep_params.u8KeySz = strlen(key);
+	strcpy((char *)&wep_params.au8WepKey[0], key);
+	return startConnectAsync(ssid, M2M_WIFI_SEC_WEP, &wep_params);
+}
+
+uint8_t WiFiClass::beginAsync(const char *ssid, const char *key)
 {
+	return startConnectAsync(ssid, M2M_WIFI_SEC_WPA_PSK, key);
+}
+
+uint8_t WiFiClass::startConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t ch)
+{
+	unsigned long start = millis();
+
 	if (!_init) {
 		init();
 	}
-	
-	// Connect to router:
-	if (_dhcp) {
-		_localip = 0;
-		_submask = 0;
-		_gateway = 0;
-	}
-	if (m2m_wifi_connect((char*)ssid, strlen(ssid), u8SecType, (void*)pvAuthInfo, M2M_WIFI_CH_ALL) < 0) {
-		_status = WL_CONNECT_FAILED;
-		return _status;
-	}
-	_status = WL_IDLE_STATUS;
-	_mode = WL_STA_MODE;
 
-	// Wait for connection or timeout:
-	for (unsigned long start = millis(); millis() - start < _timeout;)
-	{
-		m2m_wifi_handle_events(NULL);
-		if ((_status & WL_CONNECTED) || (_status & WL_DISCONNECTED)) {
+	saveCredentials(u8SecType, pvAuthInfo);
+
+	for (;;) {
+		if (requestConnect(ssid, u8SecType, pvAuthInfo, ch) < 0) {
+			_status = WL_CONNECT_FAILED;
+			return _status;
+		}
+
+		// Wait for connection or timeout:
+		while (millis() - start < _timeout) {
+			m2m_wifi_handle_events(NULL);
+			if ((_status & WL_CONNECTED) || (_status & WL_DISCONNECTED)) {
+				break;
+			}
+		}
+
+		if (_status == WL_CONNECTED || _connectChannel == M2M_WIFI_CH_ALL) {
+			break;
+		}
+
+		// Channel hint failed, fall back to a full scan and DHCP in what is left of the timeout:
+		resetFastReconnect();
+		if (millis() - start >= _timeout) {
 			break;
 		}
+		ch = M2M_WIFI_CH_ALL;
 	}
+
 	if (!(_status & WL_CONNECTED)) {
 		_mode = WL_RESET_MODE;
 	}
 
-	memset(_ssid, 0, M2M_MAX_SSID_LEN);
-	memcpy(_ssid, ssid, strlen(ssid));
 	return _status;
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid)
+uint8_t WiFiClass::startConnectAsync(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo)
 {
-	return beginAP(ssid, 1);
+	if (!_init) {
+		init();
+	}
+
+	saveCredentials(u8SecType, pvAuthInfo);
+	_autoReconnect = true;
+
+	if (requestConnect(ssid, u8SecType, pvAuthInfo) < 0) {
+		_status = WL_CONNECT_FAILED;
+		return _status;
+	}
+
+	return _status;
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid, uint8_t channel)
+int8_t WiFiClass::requestConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t ch)
 {
-	return startAP(ssid, M2M_WIFI_SEC_OPEN, NULL, channel);
+	_connectChannel = ch;
+
+	// Fast reconnect to the last network on its known channel:
+	if (ch == M2M_WIFI_CH_ALL && _fastReconnect && _reconnectChannel && strcmp(ssid, _ssid) == 0) {
+		_connectChannel = _reconnectChannel;
+
+		if (_reuseLease && _dhcp && _lease.u32StaticIP &&
+				(_lease.u32DhcpLeaseTime == 0 || (millis() - _leaseTime) / 1000 < _lease.u32DhcpLeaseTime)) {
+			m2m_wifi_enable_dhcp(0);
+			m2m_wifi_set_static_ip(&_lease);
+			_leaseReused = true;
+		}
+	}
+	
+	// Connect to router:
+	if (_leaseReused) {
+		_localip = _lease.u32StaticIP;
+		_submask = _lease.u32SubnetMask;
+		_gateway = _lease.u32Gateway;
+	} else if (_dhcp) {
+		_localip = 0;
+		_submask = 0;
+		_gateway = 0;
+	}
+	if (m2m_wifi_connect((char*)ssid, strlen(ssid), u8SecType, (void*)pvAuthInfo, _connectChannel) < 0) {
+		return -1;
+	}
+	_status = WL_IDLE_STATUS;
+	_mode = WL_STA_MODE;
+
+	if (ssid != _ssid) {
+		memset(_ssid, 0, M2M_MAX_SSID_LEN);
+		memcpy(_ssid, ssid, strlen(ssid));
+	}
+
+	if (_autoReconnect) {
+		_reconnectState = RECONNECT_CONNECTING;
+		_reconnectTime = millis();
+	}
+
+	return 0;
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid, uint8_t key_idx, const char* key)
+void WiFiClass::handleRoaming()
 {
-	return beginAP(ssid, key_idx, key, 1);
+	if (!_roamEnabled || _mode != WL_STA_MODE) {
+		return;
+	}
+
+	if (_roamState == ROAM_IDLE) {
+		if (_status != WL_CONNECTED || !_connInfoValid || _connectSecType == M2M_WIFI_SEC_INVALID ||
+				millis() - _roamTime < _roamInterval) {
+			return;
+		}
+
+		_roamTime = millis();
+
+		// Check the last sample, then take a new one in the background
+		if (_rssiValid && _rssi < _roamThreshold) {
+			if (startInternalScan(SCAN_INTERNAL_ROAM)) {
+				_roamState = ROAM_SCANNING;
+			}
+		} else if (!_rssiPending && m2m_wifi_req_curr_rssi() >= 0) {
+			_rssiPending = true;
+			_rssiTime = millis();
+		}
+	} else if (_roamState == ROAM_SCANNING) {
+		if (_scanInternal != SCAN_INTERNAL_ROAM) {
+			// a scan of the sketch took over
+			_roamState = ROAM_IDLE;
+			return;
+		}
+
+		checkScanTimeout();
+		if (_scanState == SCAN_STATE_RUNNING) {
+			return;
+		}
+
+		_roamState = ROAM_IDLE;
+
+		// The target is only known by channel, the firmware would just rejoin
+		// the current AP on its own channel. finishScan() learned that channel.
+		uint8_t ch = 0;
+
+		for (uint8_t i = 0; _reconnectChannel && i < _scanCount; i++) {
+			wl_scan_result_t *result = &_scanResults[i];
+
+			if (strcmp(result->ssid, _ssid) != 0 || memcmp(result->bssid, _remoteMacAddress, 6) == 0 ||
+					result->channel == _reconnectChannel ||
+					result->channel < M2M_WIFI_CH_1 || result->channel > M2M_WIFI_CH_14) {
+				continue;
+			}
+
+			// Results are sorted, the first candidate is the best one
+			if (result->rssi >= _rssi + ROAM_RSSI_MARGIN) {
+				ch = result->channel;
+			}
+			break;
+		}
+
+		endInternalScan();
+		if (ch) {
+			roamTo(ch);
+		}
+	} else if (millis() - _roamTime >= _timeout) {
+		// Stuck between APs, drop the link and let the normal path recover
+		_roamState = ROAM_IDLE;
+		m2m_wifi_disconnect();
+	}
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid, uint8_t key_idx, const char* key, uint8_t channel)
+void WiFiClass::roamTo(uint8_t ch)
 {
-	tstrM2mWifiWepParams wep_params;
+	const void *pvAuthInfo = (_connectSecType == M2M_WIFI_SEC_OPEN) ? NULL : &_connectAuth;
 
-	if (key_idx == 0) {
-		key_idx = 1; // 1 is the minimum key index
+	// Keep our address on the new AP, DHCP revalidates it once joined
+	if (_dhcp && _lease.u32StaticIP) {
+		m2m_wifi_enable_dhcp(0);
+		m2m_wifi_set_static_ip(&_lease);
+		_leaseReused = true;
 	}
 
-	memset(&wep_params, 0, sizeof(tstrM2mWifiWepParams));
-	wep_params.u8KeyIndx = key_idx;
-	wep_params.u8KeySz = strlen(key);
-	strcpy((char *)&wep_params.au8WepKey[0], key);
+	if (m2m_wifi_connect(_ssid, strlen(_ssid), _connectSecType, (void *)pvAuthInfo, ch) < 0) {
+		if (_leaseReused) {
+			m2m_wifi_enable_dhcp(1);
+			_leaseReused = false;
+		}
+		return;
+	}
 
-	return startAP(ssid, M2M_WIFI_SEC_WEP, &wep_params, channel);
+	_connectChannel = ch;
+	_roamState = ROAM_LEAVING;
+	_roamTime = millis();
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid, const char* key)
+int WiFiClass::addNetwork(const char *ssid, const char *key)
 {
-	return beginAP(ssid, key, 1);
+	if (_networkCount >= WIFI_MAX_NETWORKS) {
+		return 0;
+	}
+
+	char *ssidCopy = (char *)malloc(strlen(ssid) + 1);
+	char *keyCopy = key ? (char *)malloc(strlen(key) + 1) : NULL;
+
+	if (ssidCopy == NULL || (key && keyCopy == NULL)) {
+		free(ssidCopy);
+		free(keyCopy);
+		return 0;
+	}
+
+	strcpy(ssidCopy, ssid);
+	if (key) {
+		strcpy(keyCopy, key);
+	}
+
+	_networkSsid[_networkCount] = ssidCopy;
+	_networkKey[_networkCount] = keyCopy;
+	_networkCount++;
+
+	return 1;
 }
 
-uint8_t WiFiClass::beginAP(const char *ssid, const char* key, uint8_t channel)
+void WiFiClass::clearNetworks()
 {
-	return startAP(ssid, M2M_WIFI_SEC_WPA_PSK, key, channel);
+	for (uint8_t i = 0; i < _networkCount; i++) {
+		free(_networkSsid[i]);
+		free(_networkKey[i]);
+	}
+
+	_networkCount = 0;
+	_lastNetwork = -1;
 }
 
-uint8_t WiFiClass::startAP(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t channel)
+uint8_t WiFiClass::beginMulti()
 {
-	tstrM2MAPConfig strM2MAPConfig;
+	int8_t best = -1;
+	uint8_t ch = M2M_WIFI_CH_ALL;
 
-	if (!_init) {
-		init();
+	if (_networkCount == 0) {
+		return WL_NO_SSID_AVAIL;
 	}
 
-	if (channel == 0) {
-		channel = 1; // channel 1 is the minimum channel
-	}
+	// One scan, strongest first:
+	int8_t count = scanNetworks(WL_SCAN_SORT_RSSI);
 
-	// Enter Access Point mode:
-	memset(&strM2MAPConfig, 0x00, sizeof(tstrM2MAPConfig));
-	strcpy((char *)&strM2MAPConfig.au8SSID, ssid);
-	strM2MAPConfig.u8ListenChannel = channel;
-	strM2MAPConfig.u8SecType = u8SecType;
-	if (_localip == 0) { 
-		strM2MAPConfig.au8DHCPServerIP[0] = 192;
-		strM2MAPConfig.au8DHCPServerIP[1] = 168;
-		strM2MAPConfig.au8DHCPServerIP[2] = 1;
-		strM2MAPConfig.au8DHCPServerIP[3] = 1;
-	} else {
-		memcpy(strM2MAPConfig.au8DHCPServerIP, &_localip, sizeof(_localip));
-		if (strM2MAPConfig.au8DHCPServerIP[3] == 100) {
-			// limitation of WINC1500 firmware, IP address of client is always x.x.x.100
-			_status = WL_AP_FAILED;
-			return _status;
+	for (uint8_t i = 0; i < count && best < 0; i++) {
+		for (uint8_t j = 0; j < _networkCount; j++) {
+			if (strcmp(_scanResults[i].ssid, _networkSsid[j]) == 0) {
+				best = j;
+				ch = _scanResults[i].channel;
+				break;
+			}
 		}
 	}
 
-	if (u8SecType == M2M_WIFI_SEC_WEP) {
-		tstrM2mWifiWepParams* wep_params = (tstrM2mWifiWepParams*)pvAuthInfo;
+	if (best < 0) {
+		// Not seen (hidden or missed), retry the network that worked last
+		if (_lastNetwork < 0) {
+			return WL_NO_SSID_AVAIL;
+		}
 
-		strM2MAPConfig.u8KeyIndx = wep_params->u8KeyIndx;
-		strM2MAPConfig.u8KeySz = wep_params->u8KeySz;
-		strcpy((char*)strM2MAPConfig.au8WepKey, (char *)wep_params->au8WepKey);
+		best = _lastNetwork;
 	}
 
-	if (u8SecType == M2M_WIFI_SEC_WPA_PSK) {
-		strM2MAPConfig.u8KeySz = strlen((char*)pvAuthInfo);
-		strcpy((char*)strM2MAPConfig.au8Key, (char *)pvAuthInfo);
+	const char *key = _networkKey[best];
+	uint8_t status = startConnect(_networkSsid[best], key ? M2M_WIFI_SEC_WPA_PSK : M2M_WIFI_SEC_OPEN, key, ch);
+
+	if (status == WL_CONNECTED) {
+		_lastNetwork = best;
+	}
+
+	return status;
+}
+
+void WiFiClass::saveCredentials(uint8_t u8SecType, const void *pvAuthInfo)
+{
+	// Kept for the reconnect engine
+	_connectSecType = u8SecType;
+
+	if (u8SecType == M2M_WIFI_SEC_WPA_PSK) {
+		memset(_connectAuth.psk, 0, M2M_MAX_PSK_LEN);
+		strncpy(_connectAuth.psk, (const char *)pvAuthInfo, M2M_MAX_PSK_LEN - 1);
+	} else if (u8SecType == M2M_WIFI_SEC_WEP) {
+		memcpy(&_connectAuth.wep, pvAuthInfo, sizeof(tstrM2mWifiWepParams));
+	}
+}
+
+void WiFiClass::resetFastReconnect()
+{
+	if (_leaseReused) {
+		m2m_wifi_enable_dhcp(1);
+		_leaseReused = false;
+	}
+	_lease.u32StaticIP = 0;
+	_reconnectChannel = 0;
+}
+
+void WiFiClass::scheduleReconnect()
+{
+	unsigned long delay = _backoffMin;
+
+	for (uint8_t i = 0; i < _reconnectAttempts && delay < _backoffMax; i++) {
+		delay <<= 1;
+	}
+
+	if (delay > _backoffMax) {
+		delay = _backoffMax;
+	}
+
+	if (!_reconnectSeeded) {
+		// Devices that dropped together must not draw the same jitter
+		uint8_t mac[6];
+		unsigned long seed = micros();
+
+		m2m_wifi_get_mac_address(mac);
+		for (uint8_t i = 0; i < 6; i++) {
+			seed = seed * 31 + mac[i];
+		}
+		randomSeed(seed);
+		_reconnectSeeded = true;
+	}
+
+	// Equal jitter, so devices that dropped together do not retry together:
+	_reconnectDelay = delay / 2 + random(delay / 2 + 1);
+	_reconnectTime = millis();
+	_reconnectState = RECONNECT_WAITING;
+
+	if (_reconnectAttempts < 255) {
+		_reconnectAttempts++;
+	}
+}
+
+void WiFiClass::handleReconnect()
+{
+	if (!_autoReconnect) {
+		return;
+	}
+
+	if (_reconnectState == RECONNECT_WAITING && millis() - _reconnectTime >= _reconnectDelay) {
+		const void *pvAuthInfo = (_connectSecType == M2M_WIFI_SEC_OPEN) ? NULL : &_connectAuth;
+
+		if (requestConnect(_ssid, _connectSecType, pvAuthInfo) < 0) {
+			scheduleReconnect();
+		}
+	} else if (_reconnectState == RECONNECT_CONNECTING && millis() - _reconnectTime >= _timeout) {
+		// No answer from the module, abandon this attempt
+		m2m_wifi_disconnect();
+		scheduleReconnect();
+	}
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid)
+{
+	return beginAP(ssid, 1);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, uint8_t channel)
+{
+	return startAP(ssid, M2M_WIFI_SEC_OPEN, NULL, channel);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, uint8_t key_idx, const char* key)
+{
+	return beginAP(ssid, key_idx, key, 1);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, uint8_t key_idx, const char* key, uint8_t channel)
+{
+	tstrM2mWifiWepParams wep_params;
+
+	if (key_idx == 0) {
+		key_idx = 1; // 1 is the minimum key index
+	}
+
+	memset(&wep_params, 0, sizeof(tstrM2mWifiWepParams));
+	wep_params.u8KeyIndx = key_idx;
+	wep_params.u8KeySz = strlen(key);
+	strcpy((char *)&wep_params.au8WepKey[0], key);
+
+	return startAP(ssid, M2M_WIFI_SEC_WEP, &wep_params, channel);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, const char* key)
+{
+	return beginAP(ssid, key, 1);
+}
+
+uint8_t WiFiClass::beginAP(const char *ssid, const char* key, uint8_t channel)
+{
+	return startAP(ssid, M2M_WIFI_SEC_WPA_PSK, key, channel);
+}
+
+uint8_t WiFiClass::startAP(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t channel)
+{
+	tstrM2MAPConfig strM2MAPConfig;
+
+	if (!_init) {
+		init();
+	}
+
+	if (channel == 0) {
+		channel = 1; // channel 1 is the minimum channel
+	}
+
+	// Enter Access Point mode:
+	memset(&strM2MAPConfig, 0x00, sizeof(tstrM2MAPConfig));
+	strcpy((char *)&strM2MAPConfig.au8SSID, ssid);
+	strM2MAPConfig.u8ListenChannel = channel;
+	strM2MAPConfig.u8SecType = u8SecType;
+	if (_localip == 0) { 
+		strM2MAPConfig.au8DHCPServerIP[0] = 192;
+		strM2MAPConfig.au8DHCPServerIP[1] = 168;
+		strM2MAPConfig.au8DHCPServerIP[2] = 1;
+		strM2MAPConfig.au8DHCPServerIP[3] = 1;
+	} else {
+		memcpy(strM2MAPConfig.au8DHCPServerIP, &_localip, sizeof(_localip));
+		if (strM2MAPConfig.au8DHCPServerIP[3] == 100) {
+			// limitation of WINC1500 firmware, IP address of client is always x.x.x.100
+			_status = WL_AP_FAILED;
+			return _status;
+		}
+	}
+
+	if (u8SecType == M2M_WIFI_SEC_WEP) {
+		tstrM2mWifiWepParams* wep_params = (tstrM2mWifiWepParams*)pvAuthInfo;
+
+		strM2MAPConfig.u8KeyIndx = wep_params->u8KeyIndx;
+		strM2MAPConfig.u8KeySz = wep_params->u8KeySz;
+		strcpy((char*)strM2MAPConfig.au8WepKey, (char *)wep_params->au8WepKey);
+	}
+
+	if (u8SecType == M2M_WIFI_SEC_WPA_PSK) {
+		strM2MAPConfig.u8KeySz = strlen((char*)pvAuthInfo);
+		strcpy((char*)strM2MAPConfig.au8Key, (char *)pvAuthInfo);
 	}
 
 	if (m2m_wifi_enable_ap(&strM2MAPConfig) < 0) {
@@ -687,6 +1332,8 @@ void WiFiClass::hostname(const char* name)
 
 void WiFiClass::disconnect()
 {
+	_reconnectState = RECONNECT_OFF;
+
 	// Close sockets to clean state
 	for (int i = 0; i < MAX_SOCKET; i++) {
 		WiFiSocket.close(i);
@@ -703,6 +1350,8 @@ void WiFiClass::disconnect()
 
 void WiFiClass::end()
 {
+	_reconnectState = RECONNECT_OFF;
+
 	// Close sockets to clean state
 	for (int i = 0; i < MAX_SOCKET; i++) {
 		WiFiSocket.close(i);
@@ -722,12 +1371,19 @@ void WiFiClass::end()
 	// WiFi led OFF (rev A then rev B).
 	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO15, 1);
 	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO4, 1);
+	WiFiLed.end();
 #endif
 
 	socketDeinit();
 
 	m2m_wifi_deinit(NULL);
 
+	endInternalScan();
+	freeScanResults();
+	_connInfoValid = false;
+	_rssiValid = false;
+	_rssiPending = false;
+
 	nm_bsp_deinit();
 
 	_mode = WL_RESET_MODE;
@@ -737,13 +1393,17 @@ void WiFiClass::end()
 
 uint8_t *WiFiClass::macAddress(uint8_t *mac)
 {
-	m2m_wifi_get_mac_address(mac);
 	byte tmpMac[6], i;
 	
-	m2m_wifi_get_mac_address(tmpMac);
-	
-	for(i = 0; i < 6; i++)
-		mac[i] = tmpMac[5-i];
+	if (!_macValid) {
+		if (m2m_wifi_get_mac_address(tmpMac) != M2M_SUCCESS) {
+			return mac;
+		}
+		for(i = 0; i < 6; i++)
+			_mac[i] = tmpMac[5-i];
+		_macValid = true;
+	}
+	memcpy(mac, _mac, 6);
 		
 	return mac;
 }
@@ -794,19 +1454,44 @@ uint8_t* WiFiClass::APClientMacAddress(uint8_t* mac)
 
 uint8_t* WiFiClass::remoteMacAddress(uint8_t* remoteMacAddress)
 {
-	_remoteMacAddress = remoteMacAddress;
-	memset(remoteMacAddress, 0, 6);
+	if (requestConnectionInfo()) {
+		memcpy(remoteMacAddress, _remoteMacAddress, 6);
+	} else {
+		memset(remoteMacAddress, 0, 6);
+	}
 
-	m2m_wifi_get_connection_info();
+	return remoteMacAddress;
+}
 
-	// Wait for connection or timeout:
+void WiFiClass::learnChannel()
+{
+	// The connection info has no channel, look the BSSID up in the scan results
+	for (uint8_t i = 0; i < _scanCount; i++) {
+		if (memcmp(_scanResults[i].bssid, _remoteMacAddress, 6) == 0) {
+			_reconnectChannel = _scanResults[i].channel;
+			break;
+		}
+	}
+}
+
+bool WiFiClass::requestConnectionInfo()
+{
+	if (_connInfoValid) {
+		return true;
+	}
+
+	// Not cached yet, e.g. still associating:
+	if (m2m_wifi_get_connection_info() < 0) {
+		return false;
+	}
+
+	// Wait for connection info or timeout:
 	unsigned long start = millis();
-	while (_remoteMacAddress != 0 && millis() - start < 1000) {
+	while (!_connInfoValid && millis() - start < 1000) {
 		m2m_wifi_handle_events(NULL);
 	}
 
-	_remoteMacAddress = 0;
-	return remoteMacAddress;
+	return _connInfoValid;
 }
 
 int32_t WiFiClass::RSSI()
@@ -818,26 +1503,32 @@ int32_t WiFiClass::RSSI()
 	// Clear pending events:
 	m2m_wifi_handle_events(NULL);
 
-	// Send RSSI request:
-	_resolve = 0;
-	if (m2m_wifi_req_curr_rssi() < 0) {
-		return 0;
+	// Refresh the cached value once it is older than the RSSI interval:
+	unsigned long now = millis();
+	if (!_rssiValid || now - _rssiTime >= _rssiInterval) {
+		if (!_rssiPending || now - _rssiTime >= 1000) {
+			if (m2m_wifi_req_curr_rssi() < 0) {
+				return 0;
+			}
+
+			_rssiPending = true;
+			_rssiTime = now;
+		}
 	}
 
-	// Wait for connection or timeout:
-	unsigned long start = millis();
-	while (_resolve == 0 && millis() - start < 1000) {
+	// Only wait if there is no value yet, or caching is disabled:
+	while (_rssiPending && (!_rssiValid || _rssiInterval == 0) && millis() - _rssiTime < 1000) {
 		m2m_wifi_handle_events(NULL);
 	}
 
-	int32_t rssi = _resolve;
-
-	_resolve = 0;
+	if (!_rssiValid) {
+		return 0;
+	}
 
-	return rssi;
+	return _rssi;
 }
 
-int8_t WiFiClass::scanNetworks()
+int8_t WiFiClass::scanNetworks(uint8_t options)
 {
 	wl_status_t tmp = _status;
 
@@ -845,150 +1536,456 @@ int8_t WiFiClass::scanNetworks()
 		init();
 	}
 
+	stopInternalScan();
+
+	if (_scanState == SCAN_STATE_RUNNING) {
+		return 0;
+	}
+
+	freeScanResults();
+
 	// Start scan:
 	if (m2m_wifi_request_scan(M2M_WIFI_CH_ALL) < 0) {
 		return 0;
 	}
 
-	// Wait for scan result or timeout:
+	// Wait for scan result or timeout, no internal scan may start meanwhile:
+	_scanBlocking = true;
 	_status = WL_IDLE_STATUS;
 	unsigned long start = millis();
 	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 5000) {
 		m2m_wifi_handle_events(NULL);
 	}
 	_status = tmp;
-	return m2m_wifi_get_num_ap_found();
+
+	int8_t count = fetchScanResults(options);
+	_scanBlocking = false;
+
+	_scanState = SCAN_STATE_DONE;
+
+	return count;
 }
 
-char* WiFiClass::SSID(uint8_t pos)
+int8_t WiFiClass::fetchScanResults(uint8_t options)
 {
 	wl_status_t tmp = _status;
+	uint8_t count = m2m_wifi_get_num_ap_found();
 
-	// Get scan SSID result:
-	memset(_scan_ssid, 0, M2M_MAX_SSID_LEN);
-	if (m2m_wifi_req_scan_result(pos) < 0) {
+	freeScanResults();
+
+	if (count > WIFI_SCAN_RESULTS_MAX) {
+		count = WIFI_SCAN_RESULTS_MAX;
+	}
+
+	if (count == 0) {
 		return 0;
 	}
 
-	// Wait for connection or timeout:
-	_status = WL_IDLE_STATUS;
-	unsigned long start = millis();
-	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
-		m2m_wifi_handle_events(NULL);
+	_scanResults = (wl_scan_result_t *)malloc(count * sizeof(wl_scan_result_t));
+
+	if (_scanResults == NULL) {
+		return 0;
+	}
+
+	_scanSize = count;
+
+	// Fetch every result once, accessors read from the table:
+	for (uint8_t i = 0; i < count; i++) {
+		if (m2m_wifi_req_scan_result(i) < 0) {
+			break;
+		}
+
+		_status = WL_IDLE_STATUS;
+		unsigned long start = millis();
+		while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
+			m2m_wifi_handle_events(NULL);
+		}
+
+		if (!(_status & WL_SCAN_COMPLETED)) {
+			break;
+		}
 	}
 
 	_status = tmp;
-	_resolve = 0;
 
-	return _scan_ssid;
+	sortScanResults(options);
+
+	if (_connInfoValid && _mode == WL_STA_MODE) {
+		learnChannel();
+	}
+
+	return _scanCount;
 }
 
-int32_t WiFiClass::RSSI(uint8_t pos)
+void WiFiClass::sortScanResults(uint8_t options)
 {
-	wl_status_t tmp = _status;
+	if (options & WL_SCAN_UNIQUE_SSID) {
+		// keep the strongest entry of each named network
+		uint8_t n = 0;
+
+		for (uint8_t i = 0; i < _scanCount; i++) {
+			uint8_t j;
+
+			for (j = 0; j < n; j++) {
+				if (_scanResults[i].ssid[0] && strcmp(_scanResults[i].ssid, _scanResults[j].ssid) == 0) {
+					break;
+				}
+			}
+
+			if (j == n) {
+				_scanResults[n++] = _scanResults[i];
+			} else if (_scanResults[i].rssi > _scanResults[j].rssi) {
+				_scanResults[j] = _scanResults[i];
+			}
+		}
+
+		_scanCount = n;
+	}
+
+	if (options & WL_SCAN_SORT_RSSI) {
+		// insertion sort, strongest first
+		for (uint8_t i = 1; i < _scanCount; i++) {
+			wl_scan_result_t result = _scanResults[i];
+			uint8_t j = i;
+
+			while (j > 0 && _scanResults[j - 1].rssi < result.rssi) {
+				_scanResults[j] = _scanResults[j - 1];
+				j--;
+			}
+
+			_scanResults[j] = result;
+		}
+	}
+}
+
+void WiFiClass::freeScanResults()
+{
+	if (_scanResults) {
+		free(_scanResults);
+		_scanResults = NULL;
+	}
+
+	if (_scanSsidList) {
+		free(_scanSsidList);
+		_scanSsidList = NULL;
+	}
+
+	_scanSize = 0;
+	_scanCount = 0;
+	_scanState = SCAN_STATE_IDLE;
+}
+
+int WiFiClass::startScan(const wl_scan_config_t &config)
+{
+	if (!_init) {
+		init();
+	}
+
+	stopInternalScan();
 
-	// Get scan RSSI result:
-	if (m2m_wifi_req_scan_result(pos) < 0) {
+	if (_scanState == SCAN_STATE_RUNNING) {
 		return 0;
 	}
 
-	// Wait for connection or timeout:
-	_status = WL_IDLE_STATUS;
-	unsigned long start = millis();
-	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
+	freeScanResults();
+
+	_scanChannels = config.channels & SCAN_CHANNEL_MASK;
+	_scanOptions = config.options;
+	_scanPassive = config.passive;
+	_scanDwell = config.dwellTime;
+	_scanCallback = config.callback;
+
+	if (config.ssidCount && !config.passive) {
+		// pack as: count, then length and characters of each SSID
+		uint8_t count = config.ssidCount;
+		uint16_t size = 1;
+
+		if (count > MAX_HIDDEN_SITES) {
+			count = MAX_HIDDEN_SITES;
+		}
+
+		for (uint8_t i = 0; i < count; i++) {
+			size += 1 + strnlen(config.ssids[i], M2M_MAX_SSID_LEN - 1);
+		}
+
+		_scanSsidList = (uint8_t *)malloc(size);
+
+		if (_scanSsidList == NULL) {
+			return 0;
+		}
+
+		uint8_t *p = _scanSsidList;
+
+		*p++ = count;
+		for (uint8_t i = 0; i < count; i++) {
+			uint8_t len = strnlen(config.ssids[i], M2M_MAX_SSID_LEN - 1);
+
+			*p++ = len;
+			memcpy(p, config.ssids[i], len);
+			p += len;
+		}
+	}
+
+	if (_scanDwell && !_scanPassive) {
+		tstrM2MScanOption scanOption;
+
+		scanOption.u8NumOfSlot = M2M_SCAN_DEFAULT_NUM_SLOTS;
+		scanOption.u8SlotTime = constrain(_scanDwell / M2M_SCAN_DEFAULT_NUM_SLOTS, 10, 250);
+		scanOption.u8ProbesPerSlot = M2M_SCAN_DEFAULT_NUM_PROBE;
+		scanOption.s8RssiThresh = SCAN_RSSI_THRESH;
+		m2m_wifi_set_scan_options(&scanOption);
+	}
+
+	uint8_t ch = M2M_WIFI_CH_ALL;
+
+	if (_scanChannels && _scanChannels != SCAN_CHANNEL_MASK) {
+		// one request per selected channel, lowest first
+		for (ch = M2M_WIFI_CH_1; !(_scanChannels & WL_SCAN_CHANNEL(ch)); ch++);
+		_scanChannels &= ~WL_SCAN_CHANNEL(ch);
+	} else {
+		_scanChannels = 0;
+	}
+
+	_scanState = SCAN_STATE_RUNNING;
+	_scanLastEvent = millis();
+
+	if (requestScan(ch) < 0) {
+		_scanCallback = NULL;
+		finishScan();
+		freeScanResults();
+		return 0;
+	}
+
+	return 1;
+}
+
+int8_t WiFiClass::scanComplete()
+{
+	if (_scanState == SCAN_STATE_RUNNING) {
 		m2m_wifi_handle_events(NULL);
+		checkScanTimeout();
 	}
 
-	_status = tmp;
+	if (_scanInternal) {
+		// the sketch's own results are unchanged
+		if (_userScanState == SCAN_STATE_IDLE) {
+			return WL_SCAN_FAILED;
+		}
+		return _userScanCount;
+	}
 
-	int32_t rssi = _resolve;
+	if (_scanState == SCAN_STATE_RUNNING) {
+		return WL_SCAN_RUNNING;
+	} else if (_scanState == SCAN_STATE_IDLE) {
+		return WL_SCAN_FAILED;
+	}
 
-	_resolve = 0;
+	return _scanCount;
+}
+
+int8_t WiFiClass::requestScan(uint8_t ch)
+{
+	if (_scanSsidList) {
+		return m2m_wifi_request_scan_ssid_list(ch, _scanSsidList);
+	} else if (_scanPassive) {
+		return m2m_wifi_request_scan_passive(ch, _scanDwell);
+	}
 
-	return rssi;
+	return m2m_wifi_request_scan(ch);
 }
 
-uint8_t WiFiClass::encryptionType()
-{ 
-	int8_t net = scanNetworks();
+void WiFiClass::continueScan()
+{
+	_scanLastEvent = millis();
 
-	for (uint8_t i = 0; i < net; ++i) {
-		SSID(i);
-		if (strcmp(_scan_ssid, _ssid) == 0) {
-			break;
+	// fetch the remaining results of the current channel
+	if (_scanFetchPos < _scanFetchCount && _scanCount < _scanSize) {
+		if (m2m_wifi_req_scan_result(_scanFetchPos++) >= 0) {
+			return;
+		}
+	}
+
+	// then move on to the next selected channel
+	while (_scanChannels) {
+		uint8_t ch;
+
+		for (ch = M2M_WIFI_CH_1; !(_scanChannels & WL_SCAN_CHANNEL(ch)); ch++);
+		_scanChannels &= ~WL_SCAN_CHANNEL(ch);
+
+		if (requestScan(ch) >= 0) {
+			return;
 		}
 	}
 
-	return _scan_auth;
+	finishScan();
 }
 
-uint8_t WiFiClass::encryptionType(uint8_t pos)
+void WiFiClass::finishScan()
 {
-	wl_status_t tmp = _status;
+	if (_scanDwell && !_scanPassive) {
+		tstrM2MScanOption scanOption;
 
-	// Get scan auth result:
-	if (m2m_wifi_req_scan_result(pos) < 0) {
-		return 0;
+		// restore the firmware defaults for scanNetworks()
+		scanOption.u8NumOfSlot = M2M_SCAN_DEFAULT_NUM_SLOTS;
+		scanOption.u8SlotTime = M2M_SCAN_DEFAULT_SLOT_TIME;
+		scanOption.u8ProbesPerSlot = M2M_SCAN_DEFAULT_NUM_PROBE;
+		scanOption.s8RssiThresh = SCAN_RSSI_THRESH;
+		m2m_wifi_set_scan_options(&scanOption);
 	}
 
-	// Wait for connection or timeout:
-	_status = WL_IDLE_STATUS;
-	unsigned long start = millis();
-	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
-		m2m_wifi_handle_events(NULL);
+	if (_scanSsidList) {
+		free(_scanSsidList);
+		_scanSsidList = NULL;
 	}
 
-	_status = tmp;
-	_resolve = 0;
+	sortScanResults(_scanOptions);
+	_scanState = SCAN_STATE_DONE;
 
-	return _scan_auth;
+	if (_connInfoValid && _mode == WL_STA_MODE) {
+		learnChannel();
+	}
+
+	if (_scanCallback) {
+		_scanCallback(NULL);
+	}
 }
 
-uint8_t* WiFiClass::BSSID(uint8_t pos, uint8_t* bssid)
+void WiFiClass::checkScanTimeout()
 {
-	wl_status_t tmp = _status;
+	if (_scanState == SCAN_STATE_RUNNING && millis() - _scanLastEvent > 5000) {
+		// the module stopped answering, keep what we have
+		_scanChannels = 0;
+		finishScan();
+	}
+}
 
-	_remoteMacAddress = bssid;
+int WiFiClass::startInternalScan(uint8_t purpose)
+{
+	const char *ssids[1] = { _ssid };
+	wl_scan_config_t config;
 
-	// Get scan auth result:
-	if (m2m_wifi_req_scan_result(pos) < 0) {
+	if (_scanInternal || _scanState == SCAN_STATE_RUNNING) {
 		return 0;
 	}
 
-	// Wait for connection or timeout:
-	_status = WL_IDLE_STATUS;
-	unsigned long start = millis();
-	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
+	// Background scan of our SSID, the sketch's results are kept aside
+	_userScanResults = _scanResults;
+	_userScanSize = _scanSize;
+	_userScanCount = _scanCount;
+	_userScanState = _scanState;
+	_scanResults = NULL;
+	_scanSize = 0;
+	_scanCount = 0;
+	_scanState = SCAN_STATE_IDLE;
+
+	memset(&config, 0, sizeof(config));
+	config.ssids = ssids;
+	config.ssidCount = 1;
+	config.options = WL_SCAN_SORT_RSSI;
+
+	int started = startScan(config);
+
+	// marked only now, startScan() stops internal scans
+	_scanInternal = purpose;
+	if (!started) {
+		endInternalScan();
+	}
+
+	return started;
+}
+
+void WiFiClass::stopInternalScan()
+{
+	if (!_scanInternal) {
+		return;
+	}
+
+	// The sketch's scan follows once the module is done with the current request
+	bool blocking = _scanBlocking;
+
+	_scanBlocking = true;
+	_scanChannels = 0;
+	while (_scanInternal && _scanState == SCAN_STATE_RUNNING) {
 		m2m_wifi_handle_events(NULL);
+		checkScanTimeout();
 	}
+	_scanBlocking = blocking;
 
-	_status = tmp;
-	_resolve = 0;
-	_remoteMacAddress = 0;
+	endInternalScan();
+}
 
-	return bssid;
+void WiFiClass::endInternalScan()
+{
+	if (!_scanInternal) {
+		return;
+	}
+
+	_scanInternal = SCAN_INTERNAL_NONE;
+	freeScanResults();
+	_scanResults = _userScanResults;
+	_scanSize = _userScanSize;
+	_scanCount = _userScanCount;
+	_scanState = _userScanState;
+	_userScanResults = NULL;
 }
 
-uint8_t WiFiClass::channel(uint8_t pos)
+const wl_scan_result_t* WiFiClass::scanResult(uint8_t pos)
 {
-	wl_status_t tmp = _status;
+	if (_scanInternal) {
+		return (pos < _userScanCount) ? &_userScanResults[pos] : NULL;
+	}
+
+	return (pos < _scanCount) ? &_scanResults[pos] : NULL;
+}
+
+char* WiFiClass::SSID(uint8_t pos)
+{
+	wl_scan_result_t *result = (wl_scan_result_t *)scanResult(pos);
+
+	return result ? result->ssid : 0;
+}
+
+int32_t WiFiClass::RSSI(uint8_t pos)
+{
+	const wl_scan_result_t *result = scanResult(pos);
 
-	// Get scan auth result:
-	if (m2m_wifi_req_scan_result(pos) < 0) {
+	return result ? result->rssi : 0;
+}
+
+uint8_t WiFiClass::encryptionType()
+{
+	if (!requestConnectionInfo()) {
 		return 0;
 	}
 
-	// Wait for connection or timeout:
-	_status = WL_IDLE_STATUS;
-	unsigned long start = millis();
-	while (!(_status & WL_SCAN_COMPLETED) && millis() - start < 2000) {
-		m2m_wifi_handle_events(NULL);
+	return _encryption;
+}
+
+uint8_t WiFiClass::encryptionType(uint8_t pos)
+{
+	const wl_scan_result_t *result = scanResult(pos);
+
+	return result ? result->auth : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t pos, uint8_t* bssid)
+{
+	const wl_scan_result_t *result = scanResult(pos);
+
+	if (!result) {
+		return 0;
 	}
 
-	_status = tmp;
-	_resolve = 0;
+	memcpy(bssid, result->bssid, 6);
+
+	return bssid;
+}
 
-	return _scan_channel;
+uint8_t WiFiClass::channel(uint8_t pos)
+{
+	const wl_scan_result_t *result = scanResult(pos);
+
+	return result ? result->channel : 0;
 }
 
 uint8_t WiFiClass::status()
@@ -1012,18 +2009,26 @@ int WiFiClass::hostByName(const char* aHostname, IPAddress& aResult)
 
 	} else {
 #ifdef CONF_PERIPH
-		// Network led ON (rev A then rev B).
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 0);
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 0);
+		WiFiLed.beginActivity();
+#endif
+
+#ifndef LIMITED_RAM_DEVICE
+		// .local names are resolved over multicast DNS, from its cache if possible
+		if (WiFiMDNSClass::isLocal(aHostname)) {
+			int ret = WiFiMDNS.resolve(aHostname, aResult);
+
+#ifdef CONF_PERIPH
+			WiFiLed.endActivity();
+#endif
+			return ret;
+		}
 #endif
 
 		// Send DNS request:
 		_resolve = 0;
 		if (gethostbyname((uint8 *)aHostname) < 0) {
 #ifdef CONF_PERIPH
-			// Network led OFF (rev A then rev B).
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
+			WiFiLed.endActivity();
 #endif
 			return 0;
 		}
@@ -1035,9 +2040,7 @@ int WiFiClass::hostByName(const char* aHostname, IPAddress& aResult)
 		}
 
 #ifdef CONF_PERIPH
-		// Network led OFF (rev A then rev B).
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
+		WiFiLed.endActivity();
 #endif
 
 		if (_resolve == 0) {
@@ -1058,17 +2061,167 @@ void WiFiClass::refresh(void)
 
 void WiFiClass::lowPowerMode(void)
 {
-	m2m_wifi_set_sleep_mode(M2M_PS_H_AUTOMATIC, true);
+	_psAdaptive = false;
+	setSleepMode(M2M_PS_H_AUTOMATIC);
 }
 
 void WiFiClass::maxLowPowerMode(void)
 {
-	m2m_wifi_set_sleep_mode(M2M_PS_DEEP_AUTOMATIC, true);
+	_psAdaptive = false;
+	setSleepMode(M2M_PS_DEEP_AUTOMATIC);
 }
 
 void WiFiClass::noLowPowerMode(void)
 {
-	m2m_wifi_set_sleep_mode(M2M_NO_PS, false);
+	_psAdaptive = false;
+	setSleepMode(M2M_NO_PS);
+}
+
+void WiFiClass::adaptiveLowPowerMode(unsigned long idleTime, bool deep, uint16_t listenInterval)
+{
+	if (listenInterval) {
+		tstrM2mLsnInt lsnInt;
+
+		lsnInt.u16LsnInt = listenInterval;
+		m2m_wifi_set_lsn_int(&lsnInt);
+	}
+
+	_psIdleTime = idleTime;
+	_psIdleMode = deep ? M2M_PS_DEEP_AUTOMATIC : M2M_PS_H_AUTOMATIC;
+	_psAdaptive = true;
+
+	handlePowerSave();
+}
+
+unsigned long WiFiClass::powerModeTime(uint8_t mode)
+{
+	if (mode > M2M_PS_MANUAL) {
+		return 0;
+	}
+
+	unsigned long time = _psTime[mode];
+
+	if (mode == _psMode) {
+		time += millis() - _psSince;
+	}
+
+	return time;
+}
+
+void WiFiClass::setSleepHoldTime(unsigned long holdTime)
+{
+	hif_set_hold_awake(holdTime);
+}
+
+#ifdef ETH_MODE
+int WiFiClass::setEthernetBypass(const tstrEthInitParam *param)
+{
+	if (_init) {
+		end();
+	}
+	_ethParam = param;
+
+	return param ? init() : M2M_SUCCESS;
+}
+#endif
+
+void WiFiClass::setMonitorCallback(tpfAppMonCb callback)
+{
+	_monCb = callback;
+}
+
+void WiFiClass::setLedInterval(unsigned long interval)
+{
+#ifdef CONF_PERIPH
+	WiFiLed.setInterval(interval);
+#else
+	(void)interval;
+#endif
+}
+
+void WiFiClass::setFastBoot(bool enable)
+{
+	gu8Winc1501FastBoot = enable;
+}
+
+wl_boot_time_t WiFiClass::bootTime()
+{
+	return _bootTime;
+}
+
+void WiFiClass::setSleepMode(uint8_t mode)
+{
+	unsigned long now = millis();
+
+	_psTime[_psMode] += now - _psSince;
+	_psSince = now;
+	_psMode = mode;
+
+	m2m_wifi_set_sleep_mode(mode, mode != M2M_NO_PS);
+}
+
+void WiFiClass::handlePowerSave()
+{
+	if (!_psAdaptive) {
+		return;
+	}
+
+	// Awake while sockets have traffic, power save once they have been quiet
+	uint8_t mode = _psIdleMode;
+
+	if (WiFiSocket.busy() || millis() - WiFiSocket.lastActivity() < _psIdleTime) {
+		mode = M2M_NO_PS;
+	}
+
+	if (mode != _psMode) {
+		setSleepMode(mode);
+	}
+}
+
+void WiFiClass::handleEventsDone()
+{
+	handlePowerSave();
+	if (!_scanBlocking) {
+		handleReconnect();
+		handleRoaming();
+	}
+	handleChannelScan();
+}
+
+void WiFiClass::handleChannelScan()
+{
+	if (_scanInternal == SCAN_INTERNAL_CHANNEL) {
+		checkScanTimeout();
+		if (_scanState != SCAN_STATE_RUNNING) {
+			// finishScan() learned the channel
+			endInternalScan();
+		}
+		return;
+	}
+
+	if (!_learnChannel) {
+		return;
+	}
+	if (!_fastReconnect || _reconnectChannel || _mode != WL_STA_MODE) {
+		_learnChannel = false;
+		return;
+	}
+	if (_status != WL_CONNECTED || !_connInfoValid || _scanBlocking) {
+		return;
+	}
+
+	// Retried while another scan runs
+	if (startInternalScan(SCAN_INTERNAL_CHANNEL)) {
+		_learnChannel = false;
+	}
+}
+
+extern "C" void m2m_wifi_handle_events_done(void)
+{
+#ifdef CONF_PERIPH
+	WiFiLed.update();
+#endif
+	WiFi.handleEventsDone();
 }
 
 int WiFiClass::ping(const char* hostname, uint8_t ttl)
@@ -1090,9 +2243,7 @@ int WiFiClass::ping(const String &hostname, uint8_t ttl)
 int WiFiClass::ping(IPAddress host, uint8_t ttl)
 {
 #ifdef CONF_PERIPH
-	// Network led ON (rev A then rev B).
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 0);
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 0);
+	WiFiLed.beginActivity();
 #endif
 
 	uint32_t dstHost = (uint32_t)host;
@@ -1100,9 +2251,7 @@ int WiFiClass::ping(IPAddress host, uint8_t ttl)
 
 	if (m2m_ping_req((uint32_t)host, ttl, &ping_cb) < 0) {
 #ifdef CONF_PERIPH
-		// Network led OFF (rev A then rev B).
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-		m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
+		WiFiLed.endActivity();
 #endif
 		//  Error sending ping request
 		return WL_PING_ERROR;
@@ -1115,9 +2264,7 @@ int WiFiClass::ping(IPAddress host, uint8_t ttl)
 	}
 
 #ifdef CONF_PERIPH
-	// Network led OFF (rev A then rev B).
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
+	WiFiLed.endActivity();
 #endif
 
 	if (_resolve == dstHost) {
@@ -1174,4 +2321,46 @@ void WiFiClass::setTimeout(unsigned long timeout)
 	_timeout = timeout;
 }
 
+void WiFiClass::setRSSIInterval(unsigned long interval)
+{
+	_rssiInterval = interval;
+}
+
+void WiFiClass::setAutoReconnect(bool enable)
+{
+	_autoReconnect = enable;
+
+	if (!enable) {
+		_reconnectState = RECONNECT_OFF;
+	} else if (_status == WL_CONNECTED && _mode == WL_STA_MODE) {
+		_reconnectState = RECONNECT_ARMED;
+	}
+}
+
+void WiFiClass::setReconnectBackoff(unsigned long minDelay, unsigned long maxDelay)
+{
+	_backoffMin = minDelay;
+	_backoffMax = maxDelay;
+}
+
+void WiFiClass::setStatusCallback(wl_status_cb_t callback)
+{
+	_statusCallback = callback;
+}
+
+void WiFiClass::setRoaming(bool enable, int8_t threshold, unsigned long interval)
+{
+	_roamEnabled = enable;
+	_roamThreshold = threshold;
+	_roamInterval = interval;
+	_roamTime = millis();
+}
+
+void WiFiClass::setFastReconnect(bool enable, bool reuseLease)
+{
+	_fastReconnect = enable;
+	_reuseLease = reuseLease;
+	_learnChannel = enable;
+}
+
 WiFiClass WiFi;
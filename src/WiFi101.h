@@ -69,6 +69,64 @@ typedef enum {
 	WL_AP_MODE
 } wl_mode_t;
 
+/* Scan result table */
+#if defined LIMITED_RAM_DEVICE
+#define WIFI_SCAN_RESULTS_MAX          (8u)
+#else
+#define WIFI_SCAN_RESULTS_MAX          (32u)
+#endif
+
+typedef enum {
+	WL_SCAN_SORT_RSSI   = 0x01,
+	WL_SCAN_UNIQUE_SSID = 0x02
+} wl_scan_option_t;
+
+typedef struct {
+	char ssid[M2M_MAX_SSID_LEN];
+	uint8_t bssid[6];
+	int8_t rssi;
+	uint8_t auth;
+	uint8_t channel;
+} wl_scan_result_t;
+
+typedef enum {
+	WL_SCAN_RUNNING = -1,
+	WL_SCAN_FAILED = -2
+} wl_scan_status_t;
+
+/* Called for each result as it arrives, then with NULL when the scan is done. */
+typedef void (*wl_scan_cb_t)(const wl_scan_result_t *result);
+
+#define WL_SCAN_CHANNEL(ch)            (1u << ((ch) - 1))
+
+typedef struct {
+	uint16_t channels;     // WL_SCAN_CHANNEL() bits, 0 for all channels
+	bool passive;
+	uint16_t dwellTime;    // ms per channel, 0 for the firmware default
+	const char **ssids;    // probe for these hidden networks (active only)
+	uint8_t ssidCount;
+	uint8_t options;       // wl_scan_option_t
+	wl_scan_cb_t callback;
+} wl_scan_config_t;
+
+/* Known networks for beginMulti() */
+#if defined LIMITED_RAM_DEVICE
+#define WIFI_MAX_NETWORKS              (2u)
+#else
+#define WIFI_MAX_NETWORKS              (8u)
+#endif
+
+/* Called from the event pump when the connection status changes. */
+typedef void (*wl_status_cb_t)(uint8_t status);
+
+/* Duration of the init() phases in microseconds. */
+typedef struct {
+	uint32_t reset;        // reset pulse and settle time in nm_bsp_init()
+	uint32_t bootrom;      // bootrom done and firmware start requested
+	uint32_t firmware;     // firmware up and running
+	uint32_t total;        // the whole init(), including the phases above
+} wl_boot_time_t;
+
 typedef enum {
 	WL_PING_DEST_UNREACHABLE = -1,
 	WL_PING_TIMEOUT = -2,
@@ -84,6 +142,16 @@ public:
 	void setPins(int8_t cs, int8_t irq, int8_t rst, int8_t en = -1);
 
 	int init();
+	/* Boot the module in the background: initStart() resets it and
+	 * initPoll() advances the boot without blocking.
+	 *
+	 * return: 1 while booting, then the init() result.
+	 */
+	void initStart();
+	int initPoll();
+	/* Shorter reset, a single reset and tight polling in init(). */
+	void setFastBoot(bool enable);
+	wl_boot_time_t bootTime();
 	
 	char* firmwareVersion();
 
@@ -100,6 +168,29 @@ public:
 	uint8_t begin(const String &ssid, uint8_t key_idx, const String &key) { return begin(ssid.c_str(), key_idx, key.c_str()); }
 	uint8_t begin(const String &ssid, const String &key) { return begin(ssid.c_str(), key.c_str()); }
 
+	/* Same as begin(), but return at once and keep reconnecting in the background
+	 * with exponential backoff. Progress is driven by the event pump, so any
+	 * WiFi call or status() and refresh() keep it going.
+	 */
+	uint8_t beginAsync(const char *ssid);
+	uint8_t beginAsync(const char *ssid, uint8_t key_idx, const char* key);
+	uint8_t beginAsync(const char *ssid, const char *key);
+
+	/* Add a WPA (or open, without key) network to the list used by beginMulti().
+	 *
+	 * return: 1 on success, 0 if the list is full.
+	 */
+	int addNetwork(const char *ssid, const char *key = NULL);
+	void clearNetworks();
+	/* Scan once and join the strongest known network on its channel.
+	 * The module saves the joined network, so begin() rejoins it after a reboot.
+	 */
+	uint8_t beginMulti();
+
+	void setAutoReconnect(bool enable);
+	void setReconnectBackoff(unsigned long minDelay, unsigned long maxDelay);
+	void setStatusCallback(wl_status_cb_t callback);
+
 	/* Start Wifi in Access Point, with open security.
 	 * Only one client can connect to the AP at a time.
 	 *
@@ -138,13 +229,27 @@ public:
 	uint8_t encryptionType();
 	uint8_t* BSSID(uint8_t* bssid);
 	uint8_t* APClientMacAddress(uint8_t* mac);
-	int8_t scanNetworks();
+	/* Scan and fetch all results into a local table.
+	 *
+	 * param options: WL_SCAN_SORT_RSSI and/or WL_SCAN_UNIQUE_SSID.
+	 */
+	int8_t scanNetworks(uint8_t options = 0);
 	char* SSID(uint8_t pos);
 	int32_t RSSI(uint8_t pos);
 	uint8_t encryptionType(uint8_t pos);
 	uint8_t* BSSID(uint8_t pos, uint8_t* bssid);
 	uint8_t channel(uint8_t pos);
 
+	/* Start a non-blocking scan, results go to the same table as scanNetworks().
+	 *
+	 * A background scan of the library is finished first.
+	 *
+	 * return: 1 if the scan was started, 0 otherwise.
+	 */
+	int startScan(const wl_scan_config_t &config);
+	/* return: number of results, WL_SCAN_RUNNING or WL_SCAN_FAILED. */
+	int8_t scanComplete();
+
 	uint8_t status();
 
 	int hostByName(const char* hostname, IPAddress& result);
@@ -162,32 +267,172 @@ public:
 	void maxLowPowerMode(void);
 	void noLowPowerMode(void);
 
+	/* Stay in M2M_NO_PS while sends are in flight and fall back to automatic
+	 * (or deep automatic) power save after idleTime ms without traffic.
+	 * Driven by the event pump, so socket I/O alone keeps it going.
+	 *
+	 * param listenInterval: beacon periods between wake ups, 0 keeps the current value.
+	 */
+	void adaptiveLowPowerMode(unsigned long idleTime = 1000, bool deep = false, uint16_t listenInterval = 0);
+	/* return: milliseconds spent in the given M2M_PS_* mode since init(). */
+	unsigned long powerModeTime(uint8_t mode);
+	/* Keep the module awake for holdTime ms after the last access in power
+	 * save modes, instead of a wake up per request. Wake statistics are
+	 * available through hif_get_wake_stats().
+	 */
+	void setSleepHoldTime(unsigned long holdTime);
+	/* Minimum time between two updates of the network activity led. */
+	void setLedInterval(unsigned long interval);
+#ifdef ETH_MODE
+	/* Restart the module with its TCP/IP stack bypassed, NULL to go back
+	 * to normal mode at the next init. Used by WiFiEthernetBypass.
+	 */
+	int setEthernetBypass(const tstrEthInitParam *param);
+#endif
+	/* Monitoring mode frames go to this callback. Used by WiFiSniffer. */
+	void setMonitorCallback(tpfAppMonCb callback);
+
 	void handleEvent(uint8_t u8MsgType, void *pvMsg);
 	void handleResolve(uint8_t * hostName, uint32_t hostIp);
 	void handlePingResponse(uint32 u32IPAddr, uint32 u32RTT, uint8 u8ErrorCode);
+	void handleMonitor(tstrM2MWifiRxPacketInfo *info, uint8_t *payload, uint16_t size);
+	void handleEventsDone();
 	void setTimeout(unsigned long timeout);
+	void setRSSIInterval(unsigned long interval);
+
+	/* Reconnect to the last network on its known channel. Once connected the
+	 * channel is learned from a background scan of the SSID, if no scan had it.
+	 *
+	 * param reuseLease: start with the last DHCP lease while DHCP revalidates it.
+	 */
+	void setFastReconnect(bool enable, bool reuseLease = false);
+
+	/* Move to a stronger AP of the same SSID once RSSI drops below threshold.
+	 * Sockets and the IP address are kept across the move. Driven by the event pump.
+	 * Only APs on another channel are candidates, the module picks the AP by channel.
+	 * Roam scans leave the results of scanNetworks() and startScan() untouched.
+	 */
+	void setRoaming(bool enable, int8_t threshold = -75, unsigned long interval = 5000);
 
 private:
 	int _init;
 	char _version[9];
+	uint8_t _mac[6];
+	bool _macValid;
+	wl_boot_time_t _bootTime;
+	uint8_t _initState;
+	unsigned long _initTime;
+	uint32_t _initStart;
+#ifdef ETH_MODE
+	const tstrEthInitParam *_ethParam;
+#endif
+	tpfAppMonCb _monCb;
 
 	uint32_t _localip;
 	uint32_t _submask;
 	uint32_t _gateway;
 	int _dhcp;
 	uint32_t _resolve;
-	byte *_remoteMacAddress;
+	uint8_t _remoteMacAddress[6];
+	uint8_t _encryption;
+	bool _connInfoValid;
+	int8_t _rssi;
+	bool _rssiValid;
+	bool _rssiPending;
+	unsigned long _rssiTime;
+	unsigned long _rssiInterval;
+	bool _fastReconnect;
+	bool _learnChannel;
+	bool _reuseLease;
+	bool _leaseReused;
+	uint8_t _reconnectChannel;
+	tstrM2MIPConfig _lease;
+	unsigned long _leaseTime;
+	uint16_t _connectChannel;
+	uint8_t _connectSecType;
+	union {
+		char psk[M2M_MAX_PSK_LEN];
+		tstrM2mWifiWepParams wep;
+	} _connectAuth;
+	bool _autoReconnect;
+	uint8_t _reconnectState;
+	bool _reconnectSeeded;
+	uint8_t _reconnectAttempts;
+	unsigned long _reconnectTime;
+	unsigned long _reconnectDelay;
+	unsigned long _backoffMin;
+	unsigned long _backoffMax;
+	wl_status_cb_t _statusCallback;
+	uint8_t _reportedStatus;
+	bool _roamEnabled;
+	int8_t _roamThreshold;
+	uint8_t _roamState;
+	unsigned long _roamInterval;
+	unsigned long _roamTime;
+	bool _psAdaptive;
+	uint8_t _psIdleMode;
+	uint8_t _psMode;
+	unsigned long _psIdleTime;
+	unsigned long _psSince;
+	unsigned long _psTime[M2M_PS_MANUAL + 1];
+	char *_networkSsid[WIFI_MAX_NETWORKS];
+	char *_networkKey[WIFI_MAX_NETWORKS];
+	uint8_t _networkCount;
+	int8_t _lastNetwork;
 	wl_mode_t _mode;
 	wl_status_t _status;
-	char _scan_ssid[M2M_MAX_SSID_LEN];
-	uint8_t _scan_auth;
-	uint8_t _scan_channel;
+	wl_scan_result_t *_scanResults;
+	uint8_t _scanSize;
+	uint8_t _scanCount;
+	uint8_t _scanState;
+	uint16_t _scanChannels;
+	uint8_t _scanFetchPos;
+	uint8_t _scanFetchCount;
+	uint8_t _scanOptions;
+	bool _scanPassive;
+	uint16_t _scanDwell;
+	uint8_t *_scanSsidList;
+	wl_scan_cb_t _scanCallback;
+	unsigned long _scanLastEvent;
+	bool _scanBlocking;
+	// the sketch's scan table, kept aside during an internal scan
+	uint8_t _scanInternal;
+	wl_scan_result_t *_userScanResults;
+	uint8_t _userScanSize;
+	uint8_t _userScanCount;
+	uint8_t _userScanState;
 	char _ssid[M2M_MAX_SSID_LEN];
 	unsigned long _timeout;
 
-	uint8_t startConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo);
+	uint8_t startConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t ch = M2M_WIFI_CH_ALL);
+	uint8_t startConnectAsync(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo);
+	int8_t requestConnect(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t ch = M2M_WIFI_CH_ALL);
+	void saveCredentials(uint8_t u8SecType, const void *pvAuthInfo);
+	void resetFastReconnect();
+	void scheduleReconnect();
+	void handleReconnect();
+	void handleRoaming();
+	void roamTo(uint8_t ch);
+	void setSleepMode(uint8_t mode);
+	void handlePowerSave();
 	uint8_t startAP(const char *ssid, uint8_t u8SecType, const void *pvAuthInfo, uint8_t channel);
 	uint8_t* remoteMacAddress(uint8_t* remoteMacAddress);
+	bool requestConnectionInfo();
+	void learnChannel();
+	void handleChannelScan();
+	void initParams(tstrWifiInitParam *param);
+	int initDone(int8_t ret);
+	int8_t fetchScanResults(uint8_t options);
+	void freeScanResults();
+	void sortScanResults(uint8_t options);
+	int8_t requestScan(uint8_t ch);
+	void continueScan();
+	void finishScan();
+	void checkScanTimeout();
+	int startInternalScan(uint8_t purpose);
+	void stopInternalScan();
+	void endInternalScan();
+	const wl_scan_result_t* scanResult(uint8_t pos);
 
 	uint8_t startProvision(const char *ssid, const char *url, uint8_t channel);
 };
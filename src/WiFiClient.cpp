@@ -22,6 +22,12 @@
 #include "WiFi101.h"
 #include "WiFiClient.h"
 
+#ifdef LIMITED_RAM_DEVICE
+#define SPLICE_BUFFER_SIZE 64
+#else
+#define SPLICE_BUFFER_SIZE SOCKET_BUFFER_MAX_LENGTH
+#endif
+
 WiFiClient::WiFiClient()
 {
 	_socket = -1;
@@ -101,12 +107,16 @@ size_t WiFiClient::write(uint8_t b)
 
 size_t WiFiClient::write(const uint8_t *buf, size_t size)
 {
-	if (_socket < 0 || size == 0 || !connected()) {
+	if (_socket < 0 || size == 0) {
 		setWriteError();
 		return 0;
 	}
 
-	int result = WiFiSocket.write(_socket, buf, size);
+	WiFiSocket.beginCall();
+
+	int result = connected() ? WiFiSocket.write(_socket, buf, size) : 0;
+
+	WiFiSocket.endCall();
 
 	if (result <= 0) {
 		setWriteError();
@@ -138,30 +148,132 @@ int WiFiClient::read()
 
 int WiFiClient::read(uint8_t* buf, size_t size)
 {
+	WiFiSocket.beginCall();
+
 	// sizeof(size_t) is architecture dependent
 	// but we need a 16 bit data type here
 	uint16_t size_tmp = available();
-	
-	if (size_tmp == 0) {
-		return -1;
-	}
-	
-	if (size < size_tmp) {
-		size_tmp = size;
+	int result = -1;
+
+	if (size_tmp != 0) {
+		if (size < size_tmp) {
+			size_tmp = size;
+		}
+
+		result = WiFiSocket.read(_socket, buf, size);
 	}
 
-	int result = WiFiSocket.read(_socket, buf, size);
+	WiFiSocket.endCall();
 
 	return result;
 }
 
 int WiFiClient::peek()
 {
-	if (!available()) {
-		return -1;
+	WiFiSocket.beginCall();
+
+	int result = available() ? WiFiSocket.peek(_socket) : -1;
+
+	WiFiSocket.endCall();
+
+	return result;
+}
+
+int WiFiClient::peekBytes(uint8_t *buf, size_t size)
+{
+	if (_socket < 0) {
+		return 0;
+	}
+
+	return WiFiSocket.peekBytes(_socket, buf, size);
+}
+
+const uint8_t* WiFiClient::peekSpan(size_t *length)
+{
+	int spanLength = 0;
+	const uint8_t* span = NULL;
+
+	if (_socket > -1) {
+		span = WiFiSocket.recvSpan(_socket, &spanLength);
+	}
+
+	*length = spanLength;
+
+	return span;
+}
+
+size_t WiFiClient::skip(size_t size)
+{
+	if (_socket < 0) {
+		return 0;
+	}
+
+	return WiFiSocket.skip(_socket, size);
+}
+
+bool WiFiClient::find(const char *target)
+{
+	return find(target, strlen(target));
+}
+
+bool WiFiClient::find(const char *target, size_t length)
+{
+	size_t matched = 0;
+	unsigned long start = millis();
+
+	while (_socket > -1 && matched < length) {
+		if (WiFiSocket.find(_socket, (const uint8_t *)target, length, &matched, (size_t)-1) > 0) {
+			start = millis();
+		} else if (!connected() || millis() - start >= _timeout) {
+			break;
+		}
+	}
+
+	return (matched == length);
+}
+
+size_t WiFiClient::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+	size_t index = 0;
+	uint8_t found = 0;
+	unsigned long start = millis();
+
+	while (_socket > -1 && index < length && !found) {
+		int n = WiFiSocket.readUntil(_socket, terminator, (uint8_t *)buffer + index, length - index, &found);
+
+		if (n > 0) {
+			index += n;
+			start = millis();
+		} else if (!found && (!connected() || millis() - start >= _timeout)) {
+			break;
+		}
 	}
 
-	return WiFiSocket.peek(_socket);
+	return index;
+}
+
+String WiFiClient::readStringUntil(char terminator)
+{
+	String ret;
+	char chunk[64];
+	uint8_t found = 0;
+	unsigned long start = millis();
+
+	while (_socket > -1 && !found) {
+		int n = WiFiSocket.readUntil(_socket, terminator, (uint8_t *)chunk, sizeof(chunk), &found);
+
+		if (n > 0) {
+			ret.reserve(ret.length() + n);
+			for (int i = 0; i < n; i++) {
+				ret += chunk[i];
+			}
+			start = millis();
+		} else if (!found && (!connected() || millis() - start >= _timeout)) {
+			break;
+		}
+	}
+
+	return ret;
 }
 
 void WiFiClient::flush()
@@ -188,6 +300,117 @@ uint8_t WiFiClient::connected()
 	return WiFiSocket.connected(_socket);
 }
 
+void WiFiClient::setReceiveAhead(bool enable)
+{
+	if (_socket < 0) {
+		return;
+	}
+
+	WiFiSocket.setReceiveAhead(_socket, enable);
+}
+
+size_t WiFiClient::sendFrom(Stream& source, size_t len)
+{
+	if (_socket < 0 || len == 0 || !connected()) {
+		setWriteError();
+		return 0;
+	}
+
+	uint8_t* buffers = (uint8_t*)malloc(2 * SPLICE_BUFFER_SIZE);
+
+	if (buffers == NULL) {
+		setWriteError();
+		return 0;
+	}
+
+	uint8_t* pending = buffers;
+	uint8_t* next = buffers + SPLICE_BUFFER_SIZE;
+	size_t pendingSize = source.readBytes(pending, min(len, (size_t)SPLICE_BUFFER_SIZE));
+	size_t nextSize = 0;
+	size_t sent = 0;
+	unsigned long start = millis();
+
+	len -= pendingSize;
+
+	while (pendingSize) {
+		unsigned long elapsed = millis() - start;
+
+		if (elapsed >= _timeout) {
+			setWriteError();
+			break;
+		}
+
+		sint16 err = WiFiSocket.trySend(_socket, pending, pendingSize);
+
+		if (err == SOCK_ERR_NO_ERROR) {
+			uint8_t* tmp = pending;
+
+			sent += pendingSize;
+			pending = next;
+			pendingSize = nextSize;
+			next = tmp;
+			nextSize = 0;
+
+			if (pendingSize == 0 && len) {
+				pendingSize = source.readBytes(pending, min(len, (size_t)SPLICE_BUFFER_SIZE));
+				len -= pendingSize;
+			}
+		} else if (err != SOCK_ERR_BUFFER_FULL) {
+			setWriteError();
+			break;
+		} else if (nextSize == 0 && len) {
+			// the module has no buffer for this chunk yet, read the next one meanwhile
+			nextSize = source.readBytes(next, min(len, (size_t)SPLICE_BUFFER_SIZE));
+			len -= nextSize;
+		} else if (!WiFiSocket.waitSend(_socket, _timeout - elapsed)) {
+			setWriteError();
+			break;
+		}
+	}
+
+	free(buffers);
+
+	return sent;
+}
+
+size_t WiFiClient::receiveTo(Stream& destination, size_t len)
+{
+	if (_socket < 0) {
+		return 0;
+	}
+
+	// let the module deliver the next segment while this one is written out
+	uint8_t receiveAhead = WiFiSocket.setReceiveAhead(_socket, 1);
+	size_t received = 0;
+	unsigned long start = millis();
+
+	while (received < len) {
+		size_t n;
+		const uint8_t* span = peekSpan(&n);
+
+		if (span != NULL) {
+			// write straight out of the socket buffer
+			size_t written = destination.write(span, min(n, len - received));
+
+			WiFiSocket.consume(_socket, written);
+			received += written;
+			start = millis();
+
+			if (written == 0) {
+				break;
+			}
+		} else if (!connected() || millis() - start >= _timeout) {
+			break;
+		}
+	}
+
+	if (connected()) {
+		WiFiSocket.setReceiveAhead(_socket, receiveAhead);
+	}
+
+	return received;
+}
+
 uint8_t WiFiClient::status()
 {
 	// Deprecated.
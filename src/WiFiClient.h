@@ -46,6 +46,11 @@ public:
 	virtual int read();
 	virtual int read(uint8_t *buf, size_t size);
 	virtual int peek();
+	// Look at buffered data without consuming it. peekBytes() can see up to
+	// two receive chunks, peekSpan() returns the contiguous part in place.
+	int peekBytes(uint8_t *buf, size_t size);
+	const uint8_t* peekSpan(size_t *length);
+	size_t skip(size_t size);
 	virtual void flush();
 	virtual void stop();
 	virtual uint8_t connected();
@@ -55,9 +60,37 @@ public:
 
 	using Print::write;
 
+	// Scan the socket receive buffer directly instead of reading byte by byte.
+	// Stream's versions are not virtual, so calls through a Stream& are not
+	// accelerated.
+	using Stream::find;
+	using Stream::readBytesUntil;
+	bool find(const char *target);
+	bool find(const char *target, size_t length);
+	bool find(char *target) { return find((const char *)target); }
+	bool find(uint8_t *target) { return find((const char *)target); }
+	bool find(const uint8_t *target) { return find((const char *)target); }
+	bool find(char *target, size_t length) { return find((const char *)target, length); }
+	bool find(uint8_t *target, size_t length) { return find((const char *)target, length); }
+	bool find(const uint8_t *target, size_t length) { return find((const char *)target, length); }
+	bool find(char target) { return find(&target, 1); }
+	size_t readBytesUntil(char terminator, char *buffer, size_t length);
+	size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) { return readBytesUntil(terminator, (char *)buffer, length); }
+	String readStringUntil(char terminator);
+
 	virtual IPAddress remoteIP();
 	virtual uint16_t remotePort();
 
+	// Keep a recv() posted while the application drains the current segment.
+	// Uses a second receive buffer, call after the client is connected.
+	void setReceiveAhead(bool enable);
+
+	// Copy up to len bytes between a Stream and the socket. send() copies
+	// each chunk before returning, so sendFrom() only reads the next chunk
+	// while the module refuses the current one. Both stop on the timeout.
+	size_t sendFrom(Stream& source, size_t len);
+	size_t receiveTo(Stream& destination, size_t len);
+
 private:
 	SOCKET _socket;
 
@@ -0,0 +1,124 @@
+/*
+  WiFiCrypto.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "WiFiCrypto.h"
+
+#ifdef CONF_CRYPTO_HW
+
+namespace WiFiCrypto {
+
+Sha256::Sha256() :
+	_started(0)
+{
+}
+
+Sha256::~Sha256()
+{
+	if (_started) {
+		while (m2m_crypto_sha256_hash_poll(&_ctx) == M2M_NOT_YET);
+		WiFiSocket.unlockCrypto();
+	}
+}
+
+int Sha256::begin()
+{
+	if (WiFi.status() == WL_NO_SHIELD) {
+		return 0;
+	}
+
+	// a previous hash may still be running on the engine, it keeps the lock
+	if (_started) {
+		while (m2m_crypto_sha256_hash_poll(&_ctx) == M2M_NOT_YET);
+	} else if (!WiFiSocket.lockCrypto()) {
+		return 0;
+	}
+
+	_started = (m2m_crypto_sha256_hash_init(&_ctx) == M2M_SUCCESS);
+	if (!_started) {
+		WiFiSocket.unlockCrypto();
+	}
+	return _started;
+}
+
+size_t Sha256::feed(const uint8_t* data, size_t size)
+{
+	uint32 consumed = 0;
+
+	if (!_started) {
+		return 0;
+	}
+	if (m2m_crypto_sha256_hash_feed(&_ctx, (uint8 *)data, size, &consumed) < 0) {
+		return 0;
+	}
+
+	return consumed;
+}
+
+size_t Sha256::write(uint8_t b)
+{
+	return write(&b, 1);
+}
+
+size_t Sha256::write(const uint8_t* buffer, size_t size)
+{
+	size_t written = 0;
+	uint32 consumed;
+	sint8 ret = M2M_NOT_YET;
+
+	if (!_started) {
+		return 0;
+	}
+
+	while (ret == M2M_NOT_YET) {
+		ret = m2m_crypto_sha256_hash_feed(&_ctx, (uint8 *)&buffer[written], size - written, &consumed);
+		if (ret < 0) {
+			break;
+		}
+		written += consumed;
+	}
+
+	return written;
+}
+
+int Sha256::busy()
+{
+	return _started && (m2m_crypto_sha256_hash_poll(&_ctx) == M2M_NOT_YET);
+}
+
+int Sha256::digest(uint8_t* result)
+{
+	sint8 ret;
+
+	if (!_started) {
+		return 0;
+	}
+
+	ret = m2m_crypto_sha256_hash_final(&_ctx, result);
+	if (ret == M2M_NOT_YET) {
+		return 0;
+	}
+
+	_started = 0;
+	WiFiSocket.unlockCrypto();
+	return (ret == M2M_SUCCESS) ? 1 : -1;
+}
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+  WiFiCrypto.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WIFICRYPTO_H
+#define WIFICRYPTO_H
+
+#include <Print.h>
+
+#include "WiFi101.h"
+#include "utility/WiFiSocket.h"
+
+extern "C" {
+	#include "driver/include/m2m_crypto.h"
+}
+
+#ifdef CONF_CRYPTO_HW
+
+#define WIFI_SHA256_DIGEST_LEN  (M2M_SHA256_DIGEST_LEN)
+
+namespace WiFiCrypto {
+
+// SHA-256 on the module's hash engine. Data is uploaded while the engine
+// hashes the previous upload, so the board is free between feed() calls.
+// The engine is shared with the module's TLS: begin() fails while another
+// hash is running or an SSL socket is open, and SSL sockets cannot be
+// opened until digest() has returned the result.
+class Sha256 : public Print {
+public:
+  Sha256();
+  virtual ~Sha256();
+
+  int begin();
+
+  // Takes what fits without waiting for the engine, returns the byte count.
+  size_t feed(const uint8_t* data, size_t size);
+  // Blocks until all the data is taken.
+  virtual size_t write(uint8_t b);
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  int busy();
+  // Returns 1 once the digest is written, 0 while the engine is busy
+  // and -1 on failure.
+  int digest(uint8_t* result);
+
+private:
+  tstrM2mSha256Ctxt _ctx;
+  uint8_t _started;
+};
+
+}
+
+#endif
+
+#endif /* WIFICRYPTO_H */
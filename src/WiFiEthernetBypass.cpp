@@ -0,0 +1,200 @@
+/*
+  WiFiEthernetBypass.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "WiFiEthernetBypass.h"
+
+#ifdef ETH_MODE
+
+static WiFiEthernetBypass *activeBypass = NULL;
+
+static void eth_cb(uint8 u8MsgType, void *pvMsg, void *pvCtrlBuf)
+{
+	(void)pvMsg;
+
+	if (u8MsgType == M2M_WIFI_RESP_ETHERNET_RX_PACKET && activeBypass) {
+		activeBypass->handleFrame((tstrM2mIpCtrlBuf *)pvCtrlBuf);
+	}
+}
+
+WiFiEthernetBypass::WiFiEthernetBypass() :
+	_frames(NULL),
+	_lengths(NULL),
+	_slots(0),
+	_head(0),
+	_tail(0),
+	_oversize(false),
+	_dropped(0)
+{
+}
+
+WiFiEthernetBypass::~WiFiEthernetBypass()
+{
+	end();
+}
+
+int WiFiEthernetBypass::begin(uint8_t frames)
+{
+	end();
+
+	if (frames == 0 || frames == 0xff) {
+		return 0;
+	}
+
+	// One slot more than frames: the driver always receives into a free one
+	_slots = frames + 1;
+	_frames = (uint8_t *)malloc((size_t)_slots * WIFI_ETH_SLOT_SIZE);
+	_lengths = (uint16_t *)malloc(_slots * sizeof(uint16_t));
+	if (_frames == NULL || _lengths == NULL) {
+		freeFrames();
+		return 0;
+	}
+	_head = 0;
+	_tail = 0;
+	_oversize = false;
+	_dropped = 0;
+
+	memset(&_param, 0, sizeof(_param));
+	_param.pfAppEthCb = eth_cb;
+	_param.au8ethRcvBuf = slot(0);
+	_param.u16ethRcvBufSize = WIFI_ETH_FRAME_MAX;
+	_param.u8EthernetEnable = M2M_WIFI_MODE_ETHERNET;
+
+	activeBypass = this;
+	int ret = WiFi.setEthernetBypass(&_param);
+	if (ret != M2M_SUCCESS && ret != M2M_ERR_FW_VER_MISMATCH) {
+		end();
+		return 0;
+	}
+
+	return 1;
+}
+
+void WiFiEthernetBypass::end()
+{
+	if (activeBypass == this) {
+		WiFi.setEthernetBypass(NULL);
+		activeBypass = NULL;
+	}
+	freeFrames();
+}
+
+void WiFiEthernetBypass::freeFrames()
+{
+	free(_frames);
+	free(_lengths);
+	_frames = NULL;
+	_lengths = NULL;
+	_slots = 0;
+	_head = 0;
+	_tail = 0;
+}
+
+int WiFiEthernetBypass::available()
+{
+	m2m_wifi_handle_events(NULL);
+
+	if (!_slots) {
+		return 0;
+	}
+	return (_head + _slots - _tail) % _slots;
+}
+
+const uint8_t* WiFiEthernetBypass::peekFrame(uint16_t* length)
+{
+	if (!available()) {
+		*length = 0;
+		return NULL;
+	}
+
+	*length = _lengths[_tail];
+	return slot(_tail);
+}
+
+void WiFiEthernetBypass::releaseFrame()
+{
+	if (_head != _tail) {
+		_tail = (_tail + 1) % _slots;
+	}
+}
+
+int WiFiEthernetBypass::read(uint8_t* buffer, size_t size)
+{
+	uint16_t length;
+	const uint8_t* frame = peekFrame(&length);
+
+	if (frame == NULL) {
+		return 0;
+	}
+	if (size > length) {
+		size = length;
+	}
+	memcpy(buffer, frame, size);
+	releaseFrame();
+
+	return size;
+}
+
+int WiFiEthernetBypass::send(const uint8_t* frame, uint16_t length)
+{
+	if (activeBypass != this || length > WIFI_ETH_FRAME_MAX) {
+		return 0;
+	}
+
+	return (m2m_wifi_send_ethernet_pkt((uint8 *)frame, length) == M2M_SUCCESS);
+}
+
+int WiFiEthernetBypass::addMulticast(const uint8_t* mac)
+{
+	return (m2m_wifi_enable_mac_mcast((uint8 *)mac, 1) == M2M_SUCCESS);
+}
+
+int WiFiEthernetBypass::removeMulticast(const uint8_t* mac)
+{
+	return (m2m_wifi_enable_mac_mcast((uint8 *)mac, 0) == M2M_SUCCESS);
+}
+
+void WiFiEthernetBypass::handleFrame(tstrM2mIpCtrlBuf* ctrl)
+{
+	uint8_t next;
+
+	// The frame was received into the head slot
+	if (ctrl->u16RemainigDataSize) {
+		// larger than a slot, the remaining chunks overwrite it
+		_oversize = true;
+		return;
+	}
+	if (_oversize) {
+		_oversize = false;
+		_dropped++;
+		return;
+	}
+
+	next = (_head + 1) % _slots;
+	if (next == _tail) {
+		// ring full, the head slot is reused for the next frame
+		_dropped++;
+		return;
+	}
+	_lengths[_head] = ctrl->u16DataSize;
+	_head = next;
+
+	m2m_wifi_set_receive_buffer(slot(_head), WIFI_ETH_FRAME_MAX);
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+  WiFiEthernetBypass.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WIFIETHERNETBYPASS_H
+#define WIFIETHERNETBYPASS_H
+
+#include "WiFi101.h"
+
+#ifdef ETH_MODE
+
+#define WIFI_ETH_FRAME_MAX   (1518u)
+#define WIFI_ETH_SLOT_SIZE   ((WIFI_ETH_FRAME_MAX + 3u) & ~3u)
+#define WIFI_ETH_RX_FRAMES   (4u)
+
+// Raw Ethernet frames to and from the module, for a TCP/IP stack running on
+// the board. begin() restarts the module with its own TCP/IP stack bypassed,
+// WiFiClient, WiFiServer and WiFiUDP are not available until end().
+class WiFiEthernetBypass {
+public:
+  WiFiEthernetBypass();
+  ~WiFiEthernetBypass();
+
+  int begin(uint8_t frames = WIFI_ETH_RX_FRAMES);
+  void end();
+
+  // Number of received frames, oldest first.
+  int available();
+  // Zero copy access to the oldest frame, valid until releaseFrame().
+  const uint8_t* peekFrame(uint16_t* length);
+  void releaseFrame();
+  int read(uint8_t* buffer, size_t size);
+  // Frames lost because the receive ring was full or they were too large.
+  unsigned long dropped() { return _dropped; }
+
+  // Sent to the module straight from the given buffer.
+  int send(const uint8_t* frame, uint16_t length);
+
+  int addMulticast(const uint8_t* mac);
+  int removeMulticast(const uint8_t* mac);
+
+  void handleFrame(tstrM2mIpCtrlBuf* ctrl);
+
+private:
+  uint8_t* slot(uint8_t index) { return _frames + (size_t)index * WIFI_ETH_SLOT_SIZE; }
+  void freeFrames();
+
+  uint8_t* _frames;
+  uint16_t* _lengths;
+  uint8_t _slots;
+  uint8_t _head;
+  uint8_t _tail;
+  bool _oversize;
+  unsigned long _dropped;
+  tstrEthInitParam _param;
+};
+
+#endif
+
+#endif /* WIFIETHERNETBYPASS_H */
@@ -0,0 +1,436 @@
+/*
+  WiFiMDNS.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __AVR__
+#include <strings.h>
+#endif
+
+#include "WiFiMDNS.h"
+#include "utility/MDNSPacket.h"
+
+// TTLs are kept in millis(), long ones are capped
+#define TTL_MAX (7ul * 24 * 3600)
+
+static unsigned long expiry(uint32_t ttl)
+{
+	return millis() + ((ttl > TTL_MAX) ? TTL_MAX : ttl) * 1000ul;
+}
+
+static bool expired(unsigned long expires)
+{
+	return (long)(millis() - expires) >= 0;
+}
+
+WiFiMDNSClass::WiFiMDNSClass() :
+	_hosts(NULL),
+	_services(NULL),
+	_results(NULL),
+	_resultCount(0),
+	_browse(NULL),
+	_responder(NULL),
+	_udp(NULL)
+{
+}
+
+bool WiFiMDNSClass::begin()
+{
+	if (!_hosts) {
+		// only allocated once .local names are used
+		_hosts = (HostRecord *)calloc(WIFI_MDNS_HOSTS, sizeof(HostRecord));
+		_services = (ServiceRecord *)calloc(WIFI_MDNS_SERVICES, sizeof(ServiceRecord));
+		_results = (char (*)[MDNS_NAME_SIZE])calloc(WIFI_MDNS_RESULTS, MDNS_NAME_SIZE);
+
+		if (!_hosts || !_services || !_results) {
+			end();
+			return false;
+		}
+	}
+
+	if (!_responder && !_udp) {
+		_udp = new WiFiUDP();
+		if (!_udp || !_udp->beginMulticast(IPAddress(224, 0, 0, 251), 5353)) {
+			delete _udp;
+			_udp = NULL;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void WiFiMDNSClass::end()
+{
+	if (_udp) {
+		_udp->stop();
+		delete _udp;
+		_udp = NULL;
+	}
+
+	free(_hosts);
+	free(_services);
+	free(_results);
+	_hosts = NULL;
+	_services = NULL;
+	_results = NULL;
+	_resultCount = 0;
+}
+
+void WiFiMDNSClass::attachResponder(WiFiMDNSResponder* responder)
+{
+	_responder = responder;
+
+	if (_udp) {
+		_udp->stop();
+		delete _udp;
+		_udp = NULL;
+	}
+}
+
+void WiFiMDNSClass::detachResponder(WiFiMDNSResponder* responder)
+{
+	if (_responder == responder) {
+		_responder = NULL;
+	}
+}
+
+bool WiFiMDNSClass::isLocal(const char* name)
+{
+	size_t length = strlen(name);
+
+	return length > 6 && strcasecmp(&name[length - 6], ".local") == 0;
+}
+
+int WiFiMDNSClass::resolve(const char* host, IPAddress& result, unsigned long timeout)
+{
+	HostRecord *record;
+	unsigned long start;
+	unsigned long sent;
+
+	if (!begin()) {
+		return 0;
+	}
+
+	poll();
+	record = findHost(host);
+
+	for (start = millis(), sent = start - WIFI_MDNS_RETRY; !record && millis() - start < timeout; ) {
+		if (millis() - sent >= WIFI_MDNS_RETRY) {
+			if (!sendQuery(host, MDNS_TYPE_A)) {
+				return 0;
+			}
+			sent = millis();
+		}
+
+		poll();
+		record = findHost(host);
+	}
+
+	if (!record) {
+		return 0;
+	}
+
+	result = record->ip;
+	return 1;
+}
+
+int WiFiMDNSClass::browse(const char* service, const char* protocol, unsigned long timeout)
+{
+	char type[MDNS_NAME_SIZE];
+	unsigned long start;
+
+	_resultCount = 0;
+	if (!begin()) {
+		return 0;
+	}
+
+	if (snprintf(type, sizeof(type), "%s%s.%s%s.local",
+			(service[0] == '_') ? "" : "_", service,
+			(protocol[0] == '_') ? "" : "_", protocol) >= (int)sizeof(type)) {
+		return 0;
+	}
+
+	// responders send SRV and A along with the PTR answers
+	_browse = type;
+	if (sendQuery(type, MDNS_TYPE_PTR)) {
+		for (start = millis(); millis() - start < timeout; ) {
+			poll();
+		}
+	}
+	_browse = NULL;
+
+	return _resultCount;
+}
+
+const char* WiFiMDNSClass::instance(int index)
+{
+	if (index < 0 || index >= _resultCount) {
+		return NULL;
+	}
+
+	return _results[index];
+}
+
+IPAddress WiFiMDNSClass::IP(int index)
+{
+	ServiceRecord *service;
+	HostRecord *host;
+
+	if (index < 0 || index >= _resultCount) {
+		return IPAddress(0, 0, 0, 0);
+	}
+
+	service = findService(_results[index]);
+	host = service ? findHost(service->target) : NULL;
+
+	return host ? IPAddress(host->ip) : IPAddress(0, 0, 0, 0);
+}
+
+uint16_t WiFiMDNSClass::port(int index)
+{
+	ServiceRecord *service;
+
+	if (index < 0 || index >= _resultCount) {
+		return 0;
+	}
+
+	service = findService(_results[index]);
+
+	return service ? service->port : 0;
+}
+
+void WiFiMDNSClass::poll()
+{
+	if (_responder) {
+		// answers reach handleResponse() through the responder
+		_responder->poll();
+		return;
+	}
+	if (!_udp) {
+		return;
+	}
+
+	uint8_t packet[MDNS_REQUEST_SIZE];
+	int length;
+
+	while ((length = _udp->parsePacket()) > 0) {
+		if (length > MDNS_REQUEST_SIZE) {
+			length = MDNS_REQUEST_SIZE;
+		}
+		length = _udp->read(packet, length);
+		_udp->flush();
+
+		handleResponse(packet, length);
+	}
+}
+
+void WiFiMDNSClass::clearCache()
+{
+	if (_hosts) {
+		memset(_hosts, 0, WIFI_MDNS_HOSTS * sizeof(HostRecord));
+		memset(_services, 0, WIFI_MDNS_SERVICES * sizeof(ServiceRecord));
+	}
+}
+
+int WiFiMDNSClass::sendQuery(const char* name, uint16_t type)
+{
+	uint8_t query[MDNS_HEADER_SIZE + MDNS_NAME_SIZE + 1 + 4];
+	uint8_t *p = query;
+	const char *label = name;
+
+	if (strlen(name) >= MDNS_NAME_SIZE) {
+		return 0;
+	}
+	while (label) {
+		const char *dot = strchr(label, '.');
+
+		if ((dot ? (size_t)(dot - label) : strlen(label)) > MDNS_LABEL_MAX) {
+			return 0;
+		}
+		label = dot ? dot + 1 : NULL;
+	}
+
+	memset(p, 0, MDNS_HEADER_SIZE);
+	p[5] = 1;   // Question count = 1
+	p += MDNS_HEADER_SIZE;
+	p = mdnsPutName(p, name);
+	p = mdnsPut16(p, type);
+	p = mdnsPut16(p, MDNS_CLASS_IN);
+
+	if (_responder) {
+		_responder->send(query, p - query);
+		return 1;
+	}
+
+	_udp->beginPacket(IPAddress(224, 0, 0, 251), 5353);
+	_udp->write(query, p - query);
+	return _udp->endPacket();
+}
+
+void WiFiMDNSClass::handleResponse(const uint8_t* packet, int length)
+{
+	char name[MDNS_NAME_SIZE];
+	char target[MDNS_NAME_SIZE];
+	int offset = MDNS_HEADER_SIZE;
+
+	if (!_hosts || length < MDNS_HEADER_SIZE || !(mdnsGet16(&packet[2]) & MDNS_FLAG_RESPONSE)) {
+		return;
+	}
+
+	uint16_t questions = mdnsGet16(&packet[4]);
+	uint16_t records = mdnsGet16(&packet[6]) + mdnsGet16(&packet[8]) + mdnsGet16(&packet[10]);
+
+	for (int q = 0; q < questions; q++) {
+		offset = mdnsReadName(packet, length, offset, name, sizeof(name));
+		if (offset < 0) {
+			return;
+		}
+		offset += 4;
+	}
+
+	for (int r = 0; r < records; r++) {
+		offset = mdnsReadName(packet, length, offset, name, sizeof(name));
+		if (offset < 0 || offset + MDNS_RECORD_SIZE > length) {
+			return;
+		}
+
+		uint16_t type = mdnsGet16(&packet[offset]);
+		uint32_t ttl = mdnsGet32(&packet[offset + 4]);
+		uint16_t rdlength = mdnsGet16(&packet[offset + 8]);
+
+		offset += MDNS_RECORD_SIZE;
+		if (offset + rdlength > length) {
+			return;
+		}
+
+		if (!name[0]) {
+			// too long for the cache
+		} else if (type == MDNS_TYPE_A && rdlength == 4) {
+			uint32_t ip;
+
+			memcpy(&ip, &packet[offset], sizeof(ip));
+			addHost(name, ip, ttl);
+		} else if (type == MDNS_TYPE_SRV && rdlength > 6) {
+			if (mdnsReadName(packet, length, offset + 6, target, sizeof(target)) > 0 && target[0]) {
+				addService(name, target, mdnsGet16(&packet[offset + 4]), ttl);
+			}
+		} else if (type == MDNS_TYPE_PTR && _browse && ttl && strcasecmp(name, _browse) == 0) {
+			if (mdnsReadName(packet, length, offset, target, sizeof(target)) > 0 && target[0]) {
+				addResult(target);
+			}
+		}
+
+		offset += rdlength;
+	}
+}
+
+WiFiMDNSClass::HostRecord* WiFiMDNSClass::findHost(const char* name, bool any)
+{
+	HostRecord *oldest = NULL;
+
+	if (!_hosts) {
+		return NULL;
+	}
+
+	for (int i = 0; i < WIFI_MDNS_HOSTS; i++) {
+		HostRecord *record = &_hosts[i];
+
+		if (record->name[0] && !expired(record->expires) && strcasecmp(record->name, name) == 0) {
+			return record;
+		}
+		if (any && (!oldest || !record->name[0] || expired(record->expires) ||
+				(oldest->name[0] && (long)(record->expires - oldest->expires) < 0))) {
+			oldest = record;
+		}
+	}
+
+	return oldest;
+}
+
+WiFiMDNSClass::ServiceRecord* WiFiMDNSClass::findService(const char* name, bool any)
+{
+	ServiceRecord *oldest = NULL;
+
+	if (!_services) {
+		return NULL;
+	}
+
+	for (int i = 0; i < WIFI_MDNS_SERVICES; i++) {
+		ServiceRecord *record = &_services[i];
+
+		if (record->name[0] && !expired(record->expires) && strcasecmp(record->name, name) == 0) {
+			return record;
+		}
+		if (any && (!oldest || !record->name[0] || expired(record->expires) ||
+				(oldest->name[0] && (long)(record->expires - oldest->expires) < 0))) {
+			oldest = record;
+		}
+	}
+
+	return oldest;
+}
+
+void WiFiMDNSClass::addHost(const char* name, uint32_t ip, uint32_t ttl)
+{
+	// the known entry, or else a free or the soonest expiring one
+	HostRecord *record = findHost(name, true);
+
+	if (!ttl) {
+		// goodbye
+		if (strcasecmp(record->name, name) == 0) {
+			record->name[0] = '\0';
+		}
+		return;
+	}
+
+	strcpy(record->name, name);
+	record->ip = ip;
+	record->expires = expiry(ttl);
+}
+
+void WiFiMDNSClass::addService(const char* name, const char* target, uint16_t port, uint32_t ttl)
+{
+	ServiceRecord *record = findService(name, true);
+
+	if (!ttl) {
+		if (strcasecmp(record->name, name) == 0) {
+			record->name[0] = '\0';
+		}
+		return;
+	}
+
+	strcpy(record->name, name);
+	strcpy(record->target, target);
+	record->port = port;
+	record->expires = expiry(ttl);
+}
+
+void WiFiMDNSClass::addResult(const char* name)
+{
+	for (int i = 0; i < _resultCount; i++) {
+		if (strcasecmp(_results[i], name) == 0) {
+			return;
+		}
+	}
+
+	if (_resultCount < WIFI_MDNS_RESULTS) {
+		strcpy(_results[_resultCount++], name);
+	}
+}
+
+WiFiMDNSClass WiFiMDNS;
@@ -0,0 +1,101 @@
+/*
+  WiFiMDNS.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WIFIMDNS_H
+#define WIFIMDNS_H
+
+#include "WiFi101.h"
+#include "WiFiUdp.h"
+#include "WiFiMDNSResponder.h"
+
+#if defined LIMITED_RAM_DEVICE
+#define WIFI_MDNS_HOSTS     (2)
+#define WIFI_MDNS_SERVICES  (1)
+#define WIFI_MDNS_RESULTS   (2)
+#else
+#define WIFI_MDNS_HOSTS     (8)
+#define WIFI_MDNS_SERVICES  (4)
+#define WIFI_MDNS_RESULTS   (8)
+#endif
+
+#define WIFI_MDNS_TIMEOUT   (3000u)
+#define WIFI_MDNS_RETRY     (1000u)
+
+// .local names and DNS-SD browsing over multicast DNS. A and SRV answers are
+// cached for their TTL, and WiFi.hostByName() resolves .local names here
+// except on LIMITED_RAM_DEVICE boards, to keep it out of sketches not using it.
+// With a WiFiMDNSResponder running, its multicast socket is shared.
+class WiFiMDNSClass {
+public:
+  WiFiMDNSClass();
+
+  int resolve(const char* host, IPAddress& result, unsigned long timeout = WIFI_MDNS_TIMEOUT);
+
+  // Service instances, for example browse("http", "tcp"). Returns how many
+  // were found, their host and port come from the SRV and A answers.
+  int browse(const char* service, const char* protocol, unsigned long timeout = WIFI_MDNS_TIMEOUT);
+  const char* instance(int index);
+  IPAddress IP(int index);
+  uint16_t port(int index);
+
+  // Reads announcements and answers into the cache.
+  void poll();
+  void clearCache();
+  void end();
+
+  static bool isLocal(const char* name);
+
+  void handleResponse(const uint8_t* packet, int length);
+  void attachResponder(WiFiMDNSResponder* responder);
+  void detachResponder(WiFiMDNSResponder* responder);
+
+private:
+  struct HostRecord {
+    char name[MDNS_NAME_SIZE];
+    uint32_t ip;
+    unsigned long expires;
+  };
+
+  struct ServiceRecord {
+    char name[MDNS_NAME_SIZE];
+    char target[MDNS_NAME_SIZE];
+    uint16_t port;
+    unsigned long expires;
+  };
+
+  bool begin();
+  int sendQuery(const char* name, uint16_t type);
+  HostRecord* findHost(const char* name, bool any = false);
+  ServiceRecord* findService(const char* name, bool any = false);
+  void addHost(const char* name, uint32_t ip, uint32_t ttl);
+  void addService(const char* name, const char* target, uint16_t port, uint32_t ttl);
+  void addResult(const char* name);
+
+  HostRecord* _hosts;
+  ServiceRecord* _services;
+  char (*_results)[MDNS_NAME_SIZE];
+  uint8_t _resultCount;
+  const char* _browse;
+  WiFiMDNSResponder* _responder;
+  WiFiUDP* _udp;
+};
+
+extern WiFiMDNSClass WiFiMDNS;
+
+#endif /* WIFIMDNS_H */
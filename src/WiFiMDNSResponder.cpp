@@ -2,8 +2,8 @@
 // Author: Tony DiCola
 //
 // This MDNSResponder class implements just enough MDNS functionality to respond
-// to name requests, for example 'foo.local'.  This does not implement any other
-// MDNS or Bonjour functionality like services, etc.
+// to name requests, for example 'foo.local', and to DNS-SD browsing of the
+// services registered with addService().
 //
 // Copyright (c) 2016 Adafruit Industries.  All right reserved.
 //
@@ -21,82 +21,71 @@
 // License along with this library; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
-#ifdef ARDUINO_ARCH_AVR
-#include <avr/pgmspace.h>
-#endif
-#ifndef __AVR__
-#include <strings.h>
-#endif
-
 #include "Arduino.h"
 #include "WiFiMDNSResponder.h"
+#include "WiFiMDNS.h"
+#include "utility/MDNSPacket.h"
 
 // Important RFC's for reference:
 // - DNS request and response: http://www.ietf.org/rfc/rfc1035.txt
 // - Multicast DNS: http://www.ietf.org/rfc/rfc6762.txt
+// - DNS-Based Service Discovery: http://www.ietf.org/rfc/rfc6763.txt
+
+// Bits of the set of responses to send
+#define HOST_PACKET 0x01ul
+#define ENUM_PACKET 0x02ul
+#define SERVICE_PACKET(i) (0x04ul << (i))
+
+static uint8_t* putPointer(uint8_t* p, uint16_t offset)
+{
+  return mdnsPut16(p, 0xC000 | offset);
+}
 
-#define HEADER_SIZE 12
-#define TTL_OFFSET 4
-#define IP_OFFSET 10
-
-const uint8_t expectedRequestHeader[HEADER_SIZE] PROGMEM = {
-  0x00, 0x00,
-  0x00, 0x00,
-  0x00, 0x01, // questions (these 2 bytes are ignored)
-  0x00, 0x00,
-  0x00, 0x00,
-  0x00, 0x00
-};
-
-const uint8_t responseHeader[] PROGMEM = {
-  0x00, 0x00,   // ID = 0
-  0x84, 0x00,   // Flags = response + authoritative answer
-  0x00, 0x00,   // Question count = 0
-  0x00, 0x01,   // Answer count = 1
-  0x00, 0x00,   // Name server records = 0
-  0x00, 0x01    // Additional records = 1
-};
-
-// Generate positive response for IPV4 address
-const uint8_t aRecord[] PROGMEM = {
-  0x00, 0x01,                // Type = 1, A record/IPV4 address
-  0x80, 0x01,                // Class = Internet, with cache flush bit
-  0x00, 0x00, 0x00, 0x00,    // TTL in seconds, to be filled in later
-  0x00, 0x04,                // Length of record
-  0x00, 0x00, 0x00, 0x00     // IP address, to be filled in later
-};
-
-// Generate negative response for IPV6 address (CC3000 doesn't support IPV6)
-const uint8_t nsecRecord[] PROGMEM = { 
-  0xC0, 0x0C,                // Name offset
-  0x00, 0x2F,                // Type = 47, NSEC (overloaded by MDNS)
-  0x80, 0x01,                // Class = Internet, with cache flush bit
-  0x00, 0x00, 0x00, 0x00,    // TTL in seconds, to be filled in later
-  0x00, 0x08,                // Length of record
-  0xC0, 0x0C,                // Next domain = offset to FQDN
-  0x00,                      // Block number = 0
-  0x04,                      // Length of bitmap = 4 bytes
-  0x40, 0x00, 0x00, 0x00     // Bitmap value = Only first bit (A record/IPV4) is set
-};
-
-const uint8_t domain[] PROGMEM = { 'l', 'o', 'c', 'a', 'l' };
+static uint8_t* putHeader(uint8_t* p, uint16_t answers, uint16_t additional)
+{
+  p = mdnsPut16(p, 0x0000);   // ID = 0
+  p = mdnsPut16(p, 0x8400);   // Flags = response + authoritative answer
+  p = mdnsPut16(p, 0);        // Question count = 0
+  p = mdnsPut16(p, answers);
+  p = mdnsPut16(p, 0);        // Name server records = 0
+  return mdnsPut16(p, additional);
+}
+
+static uint8_t* putRecord(uint8_t* p, uint16_t type, uint16_t rrclass, uint32_t ttl, uint16_t length)
+{
+  p = mdnsPut16(p, type);
+  p = mdnsPut16(p, rrclass);
+  p = mdnsPut32(p, ttl);
+  return mdnsPut16(p, length);
+}
+
+static const char local[] = "local";
 
 WiFiMDNSResponder::WiFiMDNSResponder() :
-  minimumExpectedRequestLength(0)
+  ttlSeconds(0),
+  ip(0),
+  serviceCount(0),
+  hostPacket(NULL),
+  hostPacketLength(0),
+  enumPacket(NULL),
+  enumPacketLength(0)
 {
+  for (int i = 0; i < MDNS_MAX_SERVICES; i++) {
+    services[i].packet = NULL;
+  }
 }
 
 WiFiMDNSResponder::~WiFiMDNSResponder()
 {
+  WiFiMDNS.detachResponder(this);
+  freePackets();
 }
 
 bool WiFiMDNSResponder::begin(const char* _name, uint32_t _ttlSeconds)
 {
-  int nameLength = strlen(_name);
-
-  if (nameLength > 255) {
-    // Can only handle domains that are up to 255 chars in length.
-    minimumExpectedRequestLength = 0;
+  if (strlen(_name) > MDNS_LABEL_MAX) {
+    // Can only handle names that fit in a single label.
+    name = "";
     return false;
   }
 
@@ -104,7 +93,7 @@ bool WiFiMDNSResponder::begin(const char* _name, uint32_t _ttlSeconds)
   ttlSeconds = _ttlSeconds;
 
   name.toLowerCase();
-  minimumExpectedRequestLength = HEADER_SIZE + 1 + nameLength + 1 + sizeof(domain) + 5;
+  build();
 
   // Open the MDNS UDP listening socket on port 5353 with multicast address
   // 224.0.0.251 (0xE00000FB)
@@ -112,111 +101,393 @@ bool WiFiMDNSResponder::begin(const char* _name, uint32_t _ttlSeconds)
     return false;
   }
 
+  // .local lookups share this socket
+  WiFiMDNS.attachResponder(this);
+
+  if (ip) {
+    send(hostPacket, hostPacketLength);
+  }
+
+  return true;
+}
+
+bool WiFiMDNSResponder::addService(const char* service, const char* protocol, uint16_t port, const char* txt)
+{
+  if (serviceCount >= MDNS_MAX_SERVICES) {
+    return false;
+  }
+
+  Service& s = services[serviceCount];
+
+  s.service = (service[0] == '_') ? String(service) : (String("_") + service);
+  s.protocol = (protocol[0] == '_') ? String(protocol) : (String("_") + protocol);
+  s.txt = txt ? txt : "";
+  s.port = port;
+
+  if (s.service.length() > MDNS_LABEL_MAX || s.protocol.length() > MDNS_LABEL_MAX) {
+    return false;
+  }
+
+  // each TXT entry is a string of up to 255 bytes
+  int entryStart = 0;
+  int entryEnd;
+  do {
+    entryEnd = s.txt.indexOf('\n', entryStart);
+    if (((entryEnd < 0) ? (int)s.txt.length() : entryEnd) - entryStart > 255) {
+      return false;
+    }
+    entryStart = entryEnd + 1;
+  } while (entryEnd >= 0);
+
+  serviceCount++;
+  if (name.length()) {
+    build();
+  }
+
   return true;
 }
 
 void WiFiMDNSResponder::poll()
 {
-  if (parseRequest()) {
-    replyToRequest();
+  if (!name.length()) {
+    return;
+  }
+
+  if (WiFi.localIP() != ip) {
+    // new address, announce it
+    build();
+    if (ip) {
+      send(hostPacket, hostPacketLength);
+    }
+  }
+
+  int length = udpSocket.parsePacket();
+
+  if (!length) {
+    return;
+  }
+
+  // only the start of very large requests is parsed
+  uint8_t request[MDNS_REQUEST_SIZE];
+
+  if (length > MDNS_REQUEST_SIZE) {
+    length = MDNS_REQUEST_SIZE;
+  }
+  length = udpSocket.read(request, length);
+  udpSocket.flush();
+
+  if (length >= MDNS_HEADER_SIZE && (mdnsGet16(&request[2]) & MDNS_FLAG_RESPONSE)) {
+    // announcements and answers to our queries feed the .local cache
+    WiFiMDNS.handleResponse(request, length);
+    return;
+  }
+
+  uint32_t answers = parseRequest(request, length);
+
+  if (answers & HOST_PACKET) {
+    send(hostPacket, hostPacketLength);
+  }
+  if (answers & ENUM_PACKET) {
+    send(enumPacket, enumPacketLength);
+  }
+  for (int i = 0; i < serviceCount; i++) {
+    if (answers & SERVICE_PACKET(i)) {
+      send(services[i].packet, services[i].packetLength);
+    }
   }
 }
 
-bool WiFiMDNSResponder::parseRequest()
+uint32_t WiFiMDNSResponder::parseRequest(const uint8_t* request, int length)
 {
-  int packetLength = udpSocket.parsePacket();
-
-  if (packetLength) {
-    // check if parsed packet matches expected request length
-    if (packetLength < minimumExpectedRequestLength) {
-      // it does not, read the full packet in and drop data
-      while(udpSocket.available()) {
-        udpSocket.read();
+  if (length < MDNS_HEADER_SIZE) {
+    return 0;
+  }
+
+  uint16_t flags = mdnsGet16(&request[2]);
+
+  if (flags & (MDNS_FLAG_RESPONSE | 0x7800)) {
+    // a response, or not a standard query
+    return 0;
+  }
+
+  uint16_t questions = mdnsGet16(&request[4]);
+  uint16_t knownAnswers = mdnsGet16(&request[6]);
+  uint32_t answers = 0;
+  uint32_t knownServices = 0;
+  int offset = MDNS_HEADER_SIZE;
+  char qname[MDNS_NAME_SIZE];
+
+  for (int q = 0; q < questions; q++) {
+    offset = mdnsReadName(request, length, offset, qname, sizeof(qname));
+    if (offset < 0 || offset + 4 > length) {
+      return answers;
+    }
+
+    uint16_t qtype = mdnsGet16(&request[offset]);
+    uint16_t qclass = mdnsGet16(&request[offset + 2]) & ~MDNS_CLASS_FLUSH;
+    bool any = (qtype == MDNS_TYPE_ANY);
+
+    offset += 4;
+    if (qclass != MDNS_CLASS_IN && qclass != MDNS_CLASS_ANY) {
+      continue;
+    }
+
+    if (mdnsMatchName(qname, name.c_str(), local)) {
+      if (any || qtype == MDNS_TYPE_A || qtype == MDNS_TYPE_AAAA) {
+        answers |= HOST_PACKET;
+      }
+    } else if (mdnsMatchName(qname, "_services", "_dns-sd", "_udp", local)) {
+      if ((any || qtype == MDNS_TYPE_PTR) && serviceCount) {
+        answers |= ENUM_PACKET;
       }
+    } else {
+      for (int i = 0; i < serviceCount; i++) {
+        const Service& s = services[i];
+
+        if (mdnsMatchName(qname, s.service.c_str(), s.protocol.c_str(), local)) {
+          if (any || qtype == MDNS_TYPE_PTR) {
+            answers |= SERVICE_PACKET(i);
+          }
+        } else if (mdnsMatchName(qname, name.c_str(), s.service.c_str(), s.protocol.c_str(), local)) {
+          if (any || qtype == MDNS_TYPE_SRV || qtype == MDNS_TYPE_TXT) {
+            answers |= SERVICE_PACKET(i);
+          }
+        }
+      }
+    }
+  }
 
-      return false;
+  // Known-answer suppression: skip the responses the querier already has
+  // with at least half of their TTL left.
+  for (int a = 0; a < knownAnswers && answers; a++) {
+    offset = mdnsReadName(request, length, offset, qname, sizeof(qname));
+    if (offset < 0 || offset + MDNS_RECORD_SIZE > length) {
+      break;
     }
 
-    // read up to the min expect request length
-    uint8_t request[minimumExpectedRequestLength];
-    udpSocket.read(request, minimumExpectedRequestLength);
+    uint16_t type = mdnsGet16(&request[offset]);
+    uint32_t ttl = mdnsGet32(&request[offset + 4]);
+    uint16_t rdlength = mdnsGet16(&request[offset + 8]);
 
-    // discard the rest
-    while(udpSocket.available()) {
-      udpSocket.read();
+    offset += MDNS_RECORD_SIZE;
+    if (offset + rdlength > length) {
+      break;
     }
 
-    // parse request
-    uint8_t requestNameLength   = request[HEADER_SIZE];
-    uint8_t* requestName        = &request[HEADER_SIZE + 1];
-    uint8_t requestDomainLength = request[HEADER_SIZE + 1 + requestNameLength];
-    uint8_t* requestDomain      = &request[HEADER_SIZE + 1 + requestNameLength + 1];
-    uint16_t requestQtype;
-    uint16_t requestQclass;
-
-    memcpy(&requestQtype, &request[minimumExpectedRequestLength - 4], sizeof(requestQtype));
-    memcpy(&requestQclass, &request[minimumExpectedRequestLength - 2], sizeof(requestQclass));
-
-    requestQtype = _ntohs(requestQtype);
-    requestQclass = _ntohs(requestQclass);
-
-    // compare request
-    if (memcmp_P(request, expectedRequestHeader, 4) == 0 &&                      // request header start match
-        memcmp_P(&request[6], &expectedRequestHeader[6], 6) == 0 &&              // request header end match
-        requestNameLength == name.length() &&                                    // name length match
-        strncasecmp(name.c_str(), (char*)requestName, requestNameLength) == 0 && // name match
-        requestDomainLength == sizeof(domain) &&                                 // domain length match
-        memcmp_P(requestDomain, domain, requestDomainLength) == 0 &&             // suffix match
-        requestQtype == 0x0001 &&                                                // request QType match
-        requestQclass == 0x0001) {                                               // request QClass match
-
-      return true;
+    if (ttl >= ttlSeconds / 2) {
+      if (type == MDNS_TYPE_A) {
+        if (rdlength == 4 && memcmp(&request[offset], &ip, 4) == 0 && mdnsMatchName(qname, name.c_str(), local)) {
+          answers &= ~HOST_PACKET;
+        }
+      } else if (type == MDNS_TYPE_PTR) {
+        char target[MDNS_NAME_SIZE];
+        bool enumName = mdnsMatchName(qname, "_services", "_dns-sd", "_udp", local);
+
+        mdnsReadName(request, length, offset, target, sizeof(target));
+        for (int i = 0; i < serviceCount; i++) {
+          const Service& s = services[i];
+
+          if (enumName) {
+            if (mdnsMatchName(target, s.service.c_str(), s.protocol.c_str(), local)) {
+              knownServices |= SERVICE_PACKET(i);
+            }
+          } else if (mdnsMatchName(qname, s.service.c_str(), s.protocol.c_str(), local) &&
+                     mdnsMatchName(target, name.c_str(), s.service.c_str(), s.protocol.c_str(), local)) {
+            answers &= ~SERVICE_PACKET(i);
+          }
+        }
+      }
     }
+    offset += rdlength;
   }
 
-  return false;
+  if (serviceCount && knownServices == SERVICE_PACKET(serviceCount) - SERVICE_PACKET(0)) {
+    answers &= ~ENUM_PACKET;
+  }
+
+  return answers;
 }
 
-void WiFiMDNSResponder::replyToRequest()
+void WiFiMDNSResponder::send(const uint8_t* packet, uint16_t length)
 {
-  int nameLength = name.length();
-  int domainLength = sizeof(domain);
-  uint32_t ipAddress = WiFi.localIP();
-  uint32_t ttl = _htonl(ttlSeconds);
-
-  int responseSize = sizeof(responseHeader) + 1 + nameLength + 1 + domainLength + 1 + sizeof(aRecord) + sizeof(nsecRecord);
-  uint8_t response[responseSize];
-  uint8_t* r = response;
-
-  // copy header
-  memcpy_P(r, responseHeader, sizeof(responseHeader));
-  r += sizeof(responseHeader);
-  
-  // copy name
-  *r = nameLength;
-  memcpy(r + 1, name.c_str(), nameLength);
-  r += (1 + nameLength);
-
-  // copy domain
-  *r = domainLength;
-  memcpy_P(r + 1, domain, domainLength);
-  r += (1 + domainLength);
-
-  // terminator
-  *r = 0x00;
-  r++;
-
-  // copy A record
-  memcpy_P(r, aRecord, sizeof(aRecord));
-  memcpy(r + TTL_OFFSET, &ttl, sizeof(ttl));            // replace TTL value
-  memcpy(r + IP_OFFSET, &ipAddress, sizeof(ipAddress)); // replace IP address value
-  r += sizeof(aRecord);
-
-  // copy NSEC record
-  memcpy_P(r, nsecRecord, sizeof(nsecRecord));
-  r += sizeof(nsecRecord);
+  if (!packet) {
+    return;
+  }
 
   udpSocket.beginPacket(IPAddress(224, 0, 0, 251), 5353);
-  udpSocket.write(response, responseSize);
+  udpSocket.write(packet, length);
   udpSocket.endPacket();
 }
+
+void WiFiMDNSResponder::build()
+{
+  freePackets();
+
+  ip = WiFi.localIP();
+
+  hostPacket = buildHost(&hostPacketLength);
+  if (serviceCount) {
+    enumPacket = buildEnum(&enumPacketLength);
+  }
+  for (int i = 0; i < serviceCount; i++) {
+    services[i].packet = buildService(services[i], &services[i].packetLength);
+  }
+}
+
+void WiFiMDNSResponder::freePackets()
+{
+  free(hostPacket);
+  free(enumPacket);
+  hostPacket = NULL;
+  enumPacket = NULL;
+
+  for (int i = 0; i < MDNS_MAX_SERVICES; i++) {
+    free(services[i].packet);
+    services[i].packet = NULL;
+  }
+}
+
+// A record for <name>.local, and NSEC for the IPv6 address we do not have
+uint8_t* WiFiMDNSResponder::buildHost(uint16_t* length)
+{
+  int size = MDNS_HEADER_SIZE + (1 + name.length() + 1 + sizeof(local)) + MDNS_RECORD_SIZE + 4 + 2 + MDNS_RECORD_SIZE + 8;
+  uint8_t* packet = (uint8_t*)malloc(size);
+  uint8_t* p = packet;
+
+  if (!packet) {
+    return NULL;
+  }
+
+  p = putHeader(p, 1, 1);
+  p = mdnsPutLabel(p, name.c_str());
+  p = mdnsPutLabel(p, local);
+  *p++ = 0x00;
+
+  p = putRecord(p, MDNS_TYPE_A, MDNS_CLASS_IN | MDNS_CLASS_FLUSH, ttlSeconds, 4);
+  memcpy(p, &ip, 4);
+  p += 4;
+
+  p = putPointer(p, MDNS_HEADER_SIZE);
+  p = putRecord(p, MDNS_TYPE_NSEC, MDNS_CLASS_IN | MDNS_CLASS_FLUSH, ttlSeconds, 8);
+  p = putPointer(p, MDNS_HEADER_SIZE);   // Next domain = offset to FQDN
+  *p++ = 0x00;                      // Block number = 0
+  *p++ = 0x04;                      // Length of bitmap = 4 bytes
+  p = mdnsPut32(p, 0x40000000);         // Bitmap value = Only first bit (A record/IPV4) is set
+
+  *length = p - packet;
+  return packet;
+}
+
+// PTR records from _services._dns-sd._udp.local to each service type
+uint8_t* WiFiMDNSResponder::buildEnum(uint16_t* length)
+{
+  static const char* const labels[] = { "_services", "_dns-sd", "_udp" };
+  int size = MDNS_HEADER_SIZE + 1 + sizeof(local);
+  uint16_t localOffset = MDNS_HEADER_SIZE;
+
+  for (unsigned int i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+    size += 1 + strlen(labels[i]);
+    localOffset += 1 + strlen(labels[i]);
+  }
+  for (int i = 0; i < serviceCount; i++) {
+    size += 2 + MDNS_RECORD_SIZE + 1 + services[i].service.length() + 1 + services[i].protocol.length() + 2;
+  }
+
+  uint8_t* packet = (uint8_t*)malloc(size);
+  uint8_t* p = packet;
+
+  if (!packet) {
+    return NULL;
+  }
+
+  p = putHeader(p, serviceCount, 0);
+  for (unsigned int i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+    p = mdnsPutLabel(p, labels[i]);
+  }
+  p = mdnsPutLabel(p, local);
+  *p++ = 0x00;
+
+  for (int i = 0; i < serviceCount; i++) {
+    const Service& s = services[i];
+
+    if (i) {
+      p = putPointer(p, MDNS_HEADER_SIZE);
+    }
+    p = putRecord(p, MDNS_TYPE_PTR, MDNS_CLASS_IN, ttlSeconds, 1 + s.service.length() + 1 + s.protocol.length() + 2);
+    p = mdnsPutLabel(p, s.service.c_str());
+    p = mdnsPutLabel(p, s.protocol.c_str());
+    p = putPointer(p, localOffset);
+  }
+
+  *length = p - packet;
+  return packet;
+}
+
+// PTR, SRV and TXT records of the service, with the A record as additional
+uint8_t* WiFiMDNSResponder::buildService(Service& s, uint16_t* length)
+{
+  int nameLength = name.length();
+  int txtLength = s.txt.length();
+  int size = MDNS_HEADER_SIZE + (1 + s.service.length() + 1 + s.protocol.length() + 1 + sizeof(local)) +
+             MDNS_RECORD_SIZE + (1 + nameLength + 2) +
+             2 + MDNS_RECORD_SIZE + 6 + (1 + nameLength + 2) +
+             2 + MDNS_RECORD_SIZE + (txtLength + 1) +
+             2 + MDNS_RECORD_SIZE + 4;
+  uint8_t* packet = (uint8_t*)malloc(size);
+  uint8_t* p = packet;
+  uint16_t localOffset;
+  uint16_t instanceOffset;
+  uint16_t hostOffset;
+
+  if (!packet) {
+    return NULL;
+  }
+
+  p = putHeader(p, 3, 1);
+  p = mdnsPutLabel(p, s.service.c_str());
+  p = mdnsPutLabel(p, s.protocol.c_str());
+  localOffset = p - packet;
+  p = mdnsPutLabel(p, local);
+  *p++ = 0x00;
+
+  p = putRecord(p, MDNS_TYPE_PTR, MDNS_CLASS_IN, ttlSeconds, 1 + nameLength + 2);
+  instanceOffset = p - packet;
+  p = mdnsPutLabel(p, name.c_str());
+  p = putPointer(p, MDNS_HEADER_SIZE);
+
+  p = putPointer(p, instanceOffset);
+  p = putRecord(p, MDNS_TYPE_SRV, MDNS_CLASS_IN | MDNS_CLASS_FLUSH, ttlSeconds, 6 + 1 + nameLength + 2);
+  p = mdnsPut16(p, 0);    // Priority
+  p = mdnsPut16(p, 0);    // Weight
+  p = mdnsPut16(p, s.port);
+  hostOffset = p - packet;
+  p = mdnsPutLabel(p, name.c_str());
+  p = putPointer(p, localOffset);
+
+  p = putPointer(p, instanceOffset);
+  p = putRecord(p, MDNS_TYPE_TXT, MDNS_CLASS_IN | MDNS_CLASS_FLUSH, ttlSeconds, txtLength + 1);
+  if (txtLength) {
+    // length prefixed entries, in place of the separators
+    uint8_t* entry = p++;
+
+    for (int i = 0; i < txtLength; i++) {
+      if (s.txt[i] == '\n') {
+        *entry = p - entry - 1;
+        entry = p++;
+      } else {
+        *p++ = s.txt[i];
+      }
+    }
+    *entry = p - entry - 1;
+  } else {
+    *p++ = 0x00;
+  }
+
+  p = putPointer(p, hostOffset);
+  p = putRecord(p, MDNS_TYPE_A, MDNS_CLASS_IN | MDNS_CLASS_FLUSH, ttlSeconds, 4);
+  memcpy(p, &ip, 4);
+  p += 4;
+
+  *length = p - packet;
+  return packet;
+}
@@ -2,8 +2,8 @@
 // Author: Tony DiCola
 //
 // This MDNSResponder class implements just enough MDNS functionality to respond
-// to name requests, for example 'foo.local'.  This does not implement any other
-// MDNS or Bonjour functionality like services, etc.
+// to name requests, for example 'foo.local', and to DNS-SD browsing of the
+// services registered with addService().
 //
 // Copyright (c) 2016 Adafruit Industries.  All right reserved.
 //
@@ -27,22 +27,59 @@
 #include "WiFi101.h"
 #include "WiFiUdp.h"
 
+#if defined LIMITED_RAM_DEVICE
+#define MDNS_MAX_SERVICES  (1)
+#define MDNS_REQUEST_SIZE  (128)
+#define MDNS_NAME_SIZE     (64)
+#else
+#define MDNS_MAX_SERVICES  (4)
+#define MDNS_REQUEST_SIZE  (512)
+#define MDNS_NAME_SIZE     (128)
+#endif
+
 class WiFiMDNSResponder {
 public:
   WiFiMDNSResponder();
   ~WiFiMDNSResponder();
   bool begin(const char* _name, uint32_t _ttlSeconds = 3600);
+  // Advertise a service on this host, for example addService("http", "tcp", 80).
+  // txt holds the TXT entries, "key=value" separated by '\n'.
+  bool addService(const char* service, const char* protocol, uint16_t port, const char* txt = NULL);
   void poll();
 
 private:
-  bool parseRequest();
-  void replyToRequest();
+  friend class WiFiMDNSClass;
+
+  struct Service {
+    String service;
+    String protocol;
+    String txt;
+    uint16_t port;
+    uint8_t* packet;
+    uint16_t packetLength;
+  };
+
+  void build();
+  void freePackets();
+  uint8_t* buildHost(uint16_t* length);
+  uint8_t* buildEnum(uint16_t* length);
+  uint8_t* buildService(Service& s, uint16_t* length);
+  uint32_t parseRequest(const uint8_t* request, int length);
+  void send(const uint8_t* packet, uint16_t length);
 
 private:
   String name;
   uint32_t ttlSeconds;
+  uint32_t ip;
+
+  Service services[MDNS_MAX_SERVICES];
+  uint8_t serviceCount;
 
-  int minimumExpectedRequestLength;
+  // Responses, built at begin(), addService() and when the IP changes.
+  uint8_t* hostPacket;
+  uint16_t hostPacketLength;
+  uint8_t* enumPacket;
+  uint16_t enumPacketLength;
 
   // UDP socket for receiving/sending MDNS data.
   WiFiUDP udpSocket;
@@ -80,24 +80,30 @@ WiFiClient WiFiServer::available(uint8_t* status)
 		*status = 0;
 	}
 
+	WiFiSocket.beginCall();
+
 	if (_socket != -1 && !WiFiSocket.listening(_socket)) {
 		_socket = -1;
 	}
 
-	if (_socket != -1) {
-		SOCKET child = WiFiSocket.accepted(_socket);
+	SOCKET client = -1;
 
-		if (child > -1) {
-			return WiFiClient(child);
-		}
+	if (_socket != -1) {
+		client = WiFiSocket.accepted(_socket);
 
-		for (SOCKET s = 0; s < TCP_SOCK_MAX; s++) {
+		for (SOCKET s = 0; client < 0 && s < TCP_SOCK_MAX; s++) {
 			if (WiFiSocket.hasParent(_socket, s) && WiFiSocket.available(s)) {
-				return WiFiClient(s);
+				client = s;
 			}
 		}
 	}
 
+	WiFiSocket.endCall();
+
+	if (client > -1) {
+		return WiFiClient(client);
+	}
+
 	return WiFiClient();
 }
 
@@ -119,11 +125,15 @@ size_t WiFiServer::write(const uint8_t *buffer, size_t size)
 
 	size_t n = 0;
 
+	WiFiSocket.beginCall();
+
 	for (int sock = 0; sock < TCP_SOCK_MAX; sock++) {
 		if (WiFiSocket.hasParent(_socket, sock)) {
 			n += WiFiSocket.write(sock, buffer, size);
 		}
 	}
 
+	WiFiSocket.endCall();
+
 	return n;
 }
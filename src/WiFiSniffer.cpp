@@ -0,0 +1,308 @@
+/*
+  WiFiSniffer.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "WiFiSniffer.h"
+
+#ifndef LIMITED_RAM_DEVICE
+
+#define PCAP_LINKTYPE_RADIOTAP      (127)
+#define RADIOTAP_LENGTH             (16)
+// rate, channel, dBm antenna signal, antenna
+#define RADIOTAP_PRESENT            ((1ul << 2) | (1ul << 3) | (1ul << 5) | (1ul << 11))
+#define RADIOTAP_CHANNEL_2GHZ       (0x0080)
+
+static WiFiSniffer *activeSniffer = NULL;
+
+static uint8 filter_cb(tstrM2MWifiRxPacketInfo *pstrWifiRxPacket)
+{
+	return activeSniffer ? activeSniffer->acceptFrame(pstrWifiRxPacket) : 0;
+}
+
+static void monitor_cb(tstrM2MWifiRxPacketInfo *pstrWifiRxPacket, uint8 *pu8Payload, uint16 u16PayloadSize)
+{
+	(void)pu8Payload;
+
+	if (activeSniffer) {
+		activeSniffer->handleFrame(pstrWifiRxPacket, u16PayloadSize);
+	}
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t value)
+{
+	*p++ = value;
+	*p++ = value >> 8;
+	return p;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value)
+{
+	p = put16(p, value);
+	return put16(p, value >> 16);
+}
+
+WiFiSniffer::WiFiSniffer() :
+	_frames(NULL),
+	_info(NULL),
+	_snaplen(0),
+	_slots(0),
+	_head(0),
+	_tail(0),
+	_minRssi(-128),
+	_dropped(0),
+	_filtered(0)
+{
+	memset(&_ctrl, 0, sizeof(_ctrl));
+	_ctrl.u8ChannelID = M2M_WIFI_CH_1;
+	_ctrl.u8FrameType = WIFI_SNIFFER_ANY;
+	_ctrl.u8FrameSubtype = WIFI_SNIFFER_ANY;
+	_ctrl.u8EnRecvHdr = 1;
+}
+
+WiFiSniffer::~WiFiSniffer()
+{
+	end();
+}
+
+int WiFiSniffer::begin(uint8_t channel, uint8_t frames, uint16_t snaplen)
+{
+	end();
+
+	if (frames == 0 || frames == 0xff || snaplen == 0 || snaplen > 0xfff0) {
+		return 0;
+	}
+	if (channel < M2M_WIFI_CH_1 || channel > M2M_WIFI_CH_14) {
+		return 0;
+	}
+	if (WiFi.status() == WL_NO_SHIELD) {
+		return 0;
+	}
+
+	// One slot more than frames: the driver always receives into a free one
+	_snaplen = (snaplen + 3) & ~3;
+	_slots = frames + 1;
+	_frames = (uint8_t *)malloc((size_t)_slots * _snaplen);
+	_info = (wl_sniffer_frame_t *)malloc(_slots * sizeof(wl_sniffer_frame_t));
+	if (_frames == NULL || _info == NULL) {
+		freeFrames();
+		return 0;
+	}
+	_head = 0;
+	_tail = 0;
+	_dropped = 0;
+	_filtered = 0;
+	_last = micros();
+	_sec = 0;
+	_usec = 0;
+	_ctrl.u8ChannelID = channel;
+
+	activeSniffer = this;
+	WiFi.setMonitorCallback(monitor_cb);
+	if (enable() != M2M_SUCCESS) {
+		end();
+		return 0;
+	}
+
+	return 1;
+}
+
+void WiFiSniffer::end()
+{
+	if (activeSniffer == this) {
+		m2m_wifi_disable_monitoring_mode();
+		WiFi.setMonitorCallback(NULL);
+		activeSniffer = NULL;
+	}
+	freeFrames();
+}
+
+void WiFiSniffer::freeFrames()
+{
+	free(_frames);
+	free(_info);
+	_frames = NULL;
+	_info = NULL;
+	_slots = 0;
+	_head = 0;
+	_tail = 0;
+}
+
+int WiFiSniffer::enable()
+{
+	if (activeSniffer != this) {
+		return M2M_SUCCESS;
+	}
+
+	m2m_wifi_set_monitor_filter(filter_cb);
+	return m2m_wifi_enable_monitoring_mode(&_ctrl, slot(_head), _snaplen, 0);
+}
+
+int WiFiSniffer::setChannel(uint8_t channel)
+{
+	if (channel < M2M_WIFI_CH_1 || channel > M2M_WIFI_CH_14) {
+		return 0;
+	}
+	_ctrl.u8ChannelID = channel;
+
+	return (enable() == M2M_SUCCESS);
+}
+
+void WiFiSniffer::filterType(uint8_t type, uint8_t subtype)
+{
+	_ctrl.u8FrameType = type;
+	_ctrl.u8FrameSubtype = subtype;
+	enable();
+}
+
+void WiFiSniffer::filterBSSID(const uint8_t* bssid)
+{
+	if (bssid) {
+		memcpy(_ctrl.au8BSSID, bssid, sizeof(_ctrl.au8BSSID));
+	} else {
+		memset(_ctrl.au8BSSID, 0, sizeof(_ctrl.au8BSSID));
+	}
+	enable();
+}
+
+void WiFiSniffer::filterRSSI(int8_t minRssi)
+{
+	_minRssi = minRssi;
+}
+
+int WiFiSniffer::available()
+{
+	m2m_wifi_handle_events(NULL);
+
+	if (!_slots) {
+		return 0;
+	}
+	return (_head + _slots - _tail) % _slots;
+}
+
+const uint8_t* WiFiSniffer::peekFrame(wl_sniffer_frame_t* info)
+{
+	if (!available()) {
+		return NULL;
+	}
+
+	if (info) {
+		*info = _info[_tail];
+	}
+	return slot(_tail);
+}
+
+void WiFiSniffer::releaseFrame()
+{
+	if (_head != _tail) {
+		_tail = (_tail + 1) % _slots;
+	}
+}
+
+size_t WiFiSniffer::writePcapHeader(Print& out)
+{
+	uint8_t header[24];
+	uint8_t *p = header;
+
+	p = put32(p, 0xa1b2c3d4);
+	p = put16(p, 2);
+	p = put16(p, 4);
+	p = put32(p, 0);  // GMT
+	p = put32(p, 0);  // accuracy
+	p = put32(p, RADIOTAP_LENGTH + (_snaplen ? _snaplen : WIFI_SNIFFER_SNAPLEN));
+	put32(p, PCAP_LINKTYPE_RADIOTAP);
+
+	return out.write(header, sizeof(header));
+}
+
+int WiFiSniffer::writePcap(Print& out)
+{
+	uint8_t header[16 + RADIOTAP_LENGTH];
+	int count = available();
+
+	for (int i = 0; i < count; i++) {
+		const wl_sniffer_frame_t *info = &_info[_tail];
+		uint8_t *p = header;
+
+		// record header
+		p = put32(p, info->sec);
+		p = put32(p, info->usec);
+		p = put32(p, RADIOTAP_LENGTH + info->length);
+		p = put32(p, RADIOTAP_LENGTH + max(info->frameLength, info->length));
+
+		// radiotap header
+		*p++ = 0;
+		*p++ = 0;
+		p = put16(p, RADIOTAP_LENGTH);
+		p = put32(p, RADIOTAP_PRESENT);
+		*p++ = info->rate / 500;
+		*p++ = 0;
+		p = put16(p, (info->channel == 14) ? 2484 : (2407 + 5 * info->channel));
+		p = put16(p, RADIOTAP_CHANNEL_2GHZ);
+		*p++ = info->rssi;
+		*p++ = 0;
+
+		out.write(header, sizeof(header));
+		out.write(slot(_tail), info->length);
+		releaseFrame();
+	}
+
+	return count;
+}
+
+uint8_t WiFiSniffer::acceptFrame(tstrM2MWifiRxPacketInfo* info)
+{
+	if (info->s8RSSI < _minRssi) {
+		_filtered++;
+		return 0;
+	}
+	if ((_head + 1) % _slots == _tail) {
+		_dropped++;
+		return 0;
+	}
+
+	return 1;
+}
+
+void WiFiSniffer::handleFrame(tstrM2MWifiRxPacketInfo* info, uint16_t size)
+{
+	wl_sniffer_frame_t *frame = &_info[_head];
+	uint32_t now = micros();
+
+	// The frame was received into the head slot
+	_usec += now - _last;
+	_last = now;
+	while (_usec >= 1000000ul) {
+		_usec -= 1000000ul;
+		_sec++;
+	}
+
+	frame->length = size;
+	frame->frameLength = info->u16FrameLength;
+	frame->type = info->u8FrameType;
+	frame->subtype = info->u8FrameSubtype;
+	frame->rssi = info->s8RSSI;
+	frame->channel = _ctrl.u8ChannelID;
+	frame->rate = info->u32DataRateKbps;
+	frame->sec = _sec;
+	frame->usec = _usec;
+	_head = (_head + 1) % _slots;
+
+	m2m_wifi_set_monitor_buffer(slot(_head), _snaplen);
+}
+
+#endif
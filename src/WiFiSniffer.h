@@ -0,0 +1,105 @@
+/*
+  WiFiSniffer.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WIFISNIFFER_H
+#define WIFISNIFFER_H
+
+#include <Print.h>
+
+#include "WiFi101.h"
+
+#ifndef LIMITED_RAM_DEVICE
+
+#define WIFI_SNIFFER_FRAMES         (8u)
+#define WIFI_SNIFFER_SNAPLEN        (400u)
+
+// Frame types, as the module filters them
+#define WIFI_SNIFFER_MANAGEMENT     (0x00)
+#define WIFI_SNIFFER_CONTROL        (0x04)
+#define WIFI_SNIFFER_DATA           (0x08)
+#define WIFI_SNIFFER_ANY            (0xff)
+
+typedef struct {
+	uint16_t length;       // bytes captured, at most the snaplen
+	uint16_t frameLength;  // bytes on air
+	uint8_t type;
+	uint8_t subtype;
+	int8_t rssi;
+	uint8_t channel;
+	uint32_t rate;         // kbps
+	uint32_t sec;          // receive time since begin()
+	uint32_t usec;
+} wl_sniffer_frame_t;
+
+// 802.11 capture in monitoring mode, frames are kept in a ring until read.
+// Type, subtype and BSSID are filtered by the module, RSSI on the board
+// before the frame is read over SPI. The station must not be connected.
+class WiFiSniffer {
+public:
+  WiFiSniffer();
+  ~WiFiSniffer();
+
+  int begin(uint8_t channel, uint8_t frames = WIFI_SNIFFER_FRAMES, uint16_t snaplen = WIFI_SNIFFER_SNAPLEN);
+  void end();
+  int setChannel(uint8_t channel);
+
+  // Filters apply from begin(), or straight away when already capturing.
+  void filterType(uint8_t type, uint8_t subtype = WIFI_SNIFFER_ANY);
+  void filterBSSID(const uint8_t* bssid);  // NULL for any
+  void filterRSSI(int8_t minRssi);
+
+  int available();
+  // Zero copy access to the oldest frame, valid until releaseFrame().
+  const uint8_t* peekFrame(wl_sniffer_frame_t* info);
+  void releaseFrame();
+
+  // pcap stream with radiotap headers, the global header first.
+  size_t writePcapHeader(Print& out);
+  int writePcap(Print& out);
+
+  // Frames lost because the ring was full, and frames below the RSSI filter.
+  unsigned long dropped() { return _dropped; }
+  unsigned long filtered() { return _filtered; }
+
+  uint8_t acceptFrame(tstrM2MWifiRxPacketInfo* info);
+  void handleFrame(tstrM2MWifiRxPacketInfo* info, uint16_t size);
+
+private:
+  uint8_t* slot(uint8_t index) { return _frames + (size_t)index * _snaplen; }
+  int enable();
+  void freeFrames();
+
+  uint8_t* _frames;
+  wl_sniffer_frame_t* _info;
+  uint16_t _snaplen;
+  uint8_t _slots;
+  uint8_t _head;
+  uint8_t _tail;
+  tstrM2MWifiMonitorModeCtrl _ctrl;
+  int8_t _minRssi;
+  unsigned long _dropped;
+  unsigned long _filtered;
+  uint32_t _last;
+  uint32_t _sec;
+  uint32_t _usec;
+};
+
+#endif
+
+#endif /* WIFISNIFFER_H */
@@ -164,15 +164,17 @@ int WiFiUDP::parsePacket()
 		return 0;
 	}
 
+	WiFiSocket.beginCall();
+
 	if (_parsedPacketSize > 0) {
 		// previously parsed data, discard data
-		while (available()) {
-			read();
-		}
+		flush();
 	}
 
 	_parsedPacketSize = WiFiSocket.available(_socket);
 
+	WiFiSocket.endCall();
+
 	return _parsedPacketSize;
 }
 
@@ -189,38 +191,132 @@ int WiFiUDP::read()
 
 int WiFiUDP::read(unsigned char* buf, size_t size)
 {
+	WiFiSocket.beginCall();
+
 	// sizeof(size_t) is architecture dependent
 	// but we need a 16 bit data type here
 	uint16_t size_tmp = available();
+	int result = -1;
 
-	if (size_tmp == 0) {
-		return -1;
+	if (size_tmp != 0) {
+		if (size < size_tmp) {
+			size_tmp = size;
+		}
+
+		result = WiFiSocket.read(_socket, buf, size);
+
+		if (result > 0) {
+			_parsedPacketSize -= result;
+		}
 	}
 
-	if (size < size_tmp) {
-		size_tmp = size;
+	WiFiSocket.endCall();
+
+	return result;
+}
+
+int WiFiUDP::peek()
+{
+	WiFiSocket.beginCall();
+
+	int result = available() ? WiFiSocket.peek(_socket) : -1;
+
+	WiFiSocket.endCall();
+
+	return result;
+}
+
+bool WiFiUDP::find(const char *target)
+{
+	return find(target, strlen(target));
+}
+
+bool WiFiUDP::find(const char *target, size_t length)
+{
+	size_t matched = 0;
+
+	// a datagram is complete once parsed, no need to wait for more data
+	while (matched < length && available() > 0) {
+		int n = WiFiSocket.find(_socket, (const uint8_t *)target, length, &matched, _parsedPacketSize);
+
+		if (n <= 0) {
+			break;
+		}
+
+		_parsedPacketSize -= n;
 	}
 
-	int result = WiFiSocket.read(_socket, buf, size);
+	return (matched == length);
+}
+
+size_t WiFiUDP::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+	size_t index = 0;
+	uint8_t found = 0;
+
+	while (index < length && !found) {
+		size_t size = length - index;
+
+		if (available() <= 0) {
+			break;
+		}
+
+		if (size > (size_t)_parsedPacketSize) {
+			size = _parsedPacketSize;
+		}
+
+		int n = WiFiSocket.readUntil(_socket, terminator, (uint8_t *)buffer + index, size, &found);
+
+		if (n <= 0 && !found) {
+			break;
+		}
 
-	if (result > 0) {
-		_parsedPacketSize -= result;
+		index += n;
+		_parsedPacketSize -= (n + found);
 	}
 
-	return result;
+	return index;
 }
 
-int WiFiUDP::peek()
+String WiFiUDP::readStringUntil(char terminator)
 {
-	if (!available()) {
-		return -1;
+	String ret;
+	char chunk[64];
+	uint8_t found = 0;
+
+	while (!found && available() > 0) {
+		size_t size = sizeof(chunk);
+
+		if (size > (size_t)_parsedPacketSize) {
+			size = _parsedPacketSize;
+		}
+
+		int n = WiFiSocket.readUntil(_socket, terminator, (uint8_t *)chunk, size, &found);
+
+		if (n <= 0 && !found) {
+			break;
+		}
+
+		ret.reserve(ret.length() + n);
+		for (int i = 0; i < n; i++) {
+			ret += chunk[i];
+		}
+		_parsedPacketSize -= (n + found);
 	}
 
-	return WiFiSocket.peek(_socket);
+	return ret;
 }
 
 void WiFiUDP::flush()
 {
+	if (_socket == -1) {
+		return;
+	}
+
+	if (_parsedPacketSize > 0) {
+		WiFiSocket.discard(_socket);
+		_parsedPacketSize = 0;
+	}
 }
 
 IPAddress WiFiUDP::remoteIP()
@@ -81,6 +81,22 @@ public:
   virtual int read(char* buffer, size_t len) { return read((unsigned char*)buffer, len); };
   // Return the next byte from the current packet without moving on to the next byte
   virtual int peek();
+  // Search and delimiter reads within the current packet, scanning the socket buffer directly.
+  // Not used for calls through a Stream&, Stream's versions are not virtual.
+  using Stream::find;
+  using Stream::readBytesUntil;
+  bool find(const char *target);
+  bool find(const char *target, size_t length);
+  bool find(char *target) { return find((const char *)target); }
+  bool find(uint8_t *target) { return find((const char *)target); }
+  bool find(const uint8_t *target) { return find((const char *)target); }
+  bool find(char *target, size_t length) { return find((const char *)target, length); }
+  bool find(uint8_t *target, size_t length) { return find((const char *)target, length); }
+  bool find(const uint8_t *target, size_t length) { return find((const char *)target, length); }
+  bool find(char target) { return find(&target, 1); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) { return readBytesUntil(terminator, (char *)buffer, length); }
+  String readStringUntil(char terminator);
   virtual void flush();	// Finish reading the current packet
 
   // Return the IP address of the host who sent the current incoming packet
@@ -221,6 +221,39 @@ void nm_bsp_sleep(uint32 u32TimeMsec);
 /**@}*/
 
 
+/** @defgroup NmBspTimeFn nm_bsp_time_us
+*     @ingroup BSPAPI
+*     Free running time in units of microseconds.\n
+*    This function is used by the HIF Layer to time chip wake up and idle periods.
+*/
+/**@{*/
+/*!
+ * @fn           uint32 nm_bsp_time_us(void);
+ * @note         Implementation of this function is host dependent. The value wraps around after 2^32 microseconds.
+ * @return       Current time in microseconds
+ */
+uint32 nm_bsp_time_us(void);
+/**@}*/
+
+
+/** @defgroup NmBspSleepUsFn nm_bsp_sleep_us
+*     @ingroup BSPAPI
+*     Busy wait in units of microseconds.\n
+*    This function is used by the chip wake up to poll the chip clocks faster than @ref nm_bsp_sleep allows.
+*/
+/**@{*/
+/*!
+ * @fn           void nm_bsp_sleep_us(uint32 u32TimeUsec);
+ * @param [in]   u32TimeUsec
+ *               Time unit in microseconds
+ * @note         Implementation of this function is host dependent.
+ * @see          nm_bsp_sleep
+ * @return       None
+ */
+void nm_bsp_sleep_us(uint32 u32TimeUsec);
+/**@}*/
+
+
 /** @defgroup NmBspRegisterFn nm_bsp_register_isr
 *     @ingroup BSPAPI
 *   Register ISR (Interrupt Service Routine) in the initialization of HIF (Host Interface) Layer.
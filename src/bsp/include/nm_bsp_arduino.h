@@ -71,4 +71,24 @@ extern int8_t gi8Winc1501ResetPin;
 extern int8_t gi8Winc1501IntnPin;
 extern int8_t gi8Winc1501ChipEnPin;
 
+/*
+ * Fast boot shortens the reset pulse, skips the second reset done by the
+ * bus wrapper and polls the chip boot every millisecond.
+ */
+#define WINC1501_RESET_LOW_MS        100
+#define WINC1501_RESET_WAIT_MS       100
+#define WINC1501_FAST_RESET_LOW_MS   1
+#define WINC1501_FAST_RESET_WAIT_MS  10
+
+extern uint8_t gu8Winc1501FastBoot;
+extern uint8_t gu8Winc1501AsyncReset;
+
+/*
+ * Non-blocking reset: nm_bsp_init_async() is nm_bsp_init() with the chip
+ * left in reset until nm_bsp_reset_release(). The bus wrapper then skips
+ * its own reset.
+ */
+void nm_bsp_init_async(void);
+void nm_bsp_reset_release(void);
+
 #endif /* _NM_BSP_ARDUINO_H_ */
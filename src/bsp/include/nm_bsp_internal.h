@@ -56,4 +56,17 @@
 #define CONF_PERIPH
 #endif
 
+/* Ethernet bypass for WiFiEthernetBypass, about 260 bytes of flash and
+ * 10 bytes of RAM in the driver */
+#if defined(ARDUINO) && !defined(LIMITED_RAM_DEVICE)
+#define ETH_MODE
+#endif
+
+/* Host access to the hash engine for WiFiCrypto, only linked when used.
+ * The engine is shared with the module's TLS, WiFiSocket keeps the two
+ * apart */
+#if defined(ARDUINO) && !defined(LIMITED_RAM_DEVICE)
+#define CONF_CRYPTO_HW
+#endif
+
 #endif //_NM_BSP_INTERNAL_H_
\ No newline at end of file
@@ -50,8 +50,13 @@ int8_t gi8Winc1501CsPin = WINC1501_SPI_CS_PIN;
 int8_t gi8Winc1501ResetPin = WINC1501_RESET_PIN;
 int8_t gi8Winc1501IntnPin = WINC1501_INTN_PIN;
 int8_t gi8Winc1501ChipEnPin = WINC1501_CHIP_EN_PIN;
+uint8_t gu8Winc1501FastBoot = 0;
+uint8_t gu8Winc1501AsyncReset = 0;
 
 static tpfNmBspIsr gpfIsr;
+/* Interrupts stay attached, masking only defers them to the next unmask */
+static volatile uint8 gu8IsrMasked;
+static volatile uint8 gu8IsrPending;
 
 void __attribute__((weak)) attachInterruptMultiArch(uint32_t pin, void *chip_isr, uint32_t mode)
 {
@@ -65,7 +70,9 @@ void __attribute__((weak)) detachInterruptMultiArch(uint32_t pin)
 
 static void chip_isr(void)
 {
-	if (gpfIsr) {
+	if (gu8IsrMasked) {
+		gu8IsrPending = 1;
+	} else if (gpfIsr) {
 		gpfIsr();
 	}
 }
@@ -121,6 +128,7 @@ static void deinit_chip_pins(void)
 sint8 nm_bsp_init(void)
 {
 	gpfIsr = NULL;
+	gu8Winc1501AsyncReset = 0;
 
 	init_chip_pins();
 
@@ -129,6 +137,35 @@ sint8 nm_bsp_init(void)
 	return M2M_SUCCESS;
 }
 
+/*
+ *	@fn		nm_bsp_init_async
+ *	@brief	Initialize BSP and hold the chip in reset, see nm_bsp_reset_release
+ */
+void nm_bsp_init_async(void)
+{
+	gpfIsr = NULL;
+	gu8Winc1501AsyncReset = 1;
+
+	init_chip_pins();
+
+	if (gi8Winc1501ResetPin > -1)
+	{
+		digitalWrite(gi8Winc1501ResetPin, LOW);
+	}
+}
+
+/*
+ *	@fn		nm_bsp_reset_release
+ *	@brief	Release the reset asserted by nm_bsp_init_async
+ */
+void nm_bsp_reset_release(void)
+{
+	if (gi8Winc1501ResetPin > -1)
+	{
+		digitalWrite(gi8Winc1501ResetPin, HIGH);
+	}
+}
+
 /**
  *	@fn		nm_bsp_deinit
  *	@brief	De-iInitialize BSP
@@ -157,9 +194,9 @@ void nm_bsp_reset(void)
 	if (gi8Winc1501ResetPin > -1)
 	{
 		digitalWrite(gi8Winc1501ResetPin, LOW);
-		nm_bsp_sleep(100);
+		nm_bsp_sleep(gu8Winc1501FastBoot ? WINC1501_FAST_RESET_LOW_MS : WINC1501_RESET_LOW_MS);
 		digitalWrite(gi8Winc1501ResetPin, HIGH);
-		nm_bsp_sleep(100);
+		nm_bsp_sleep(gu8Winc1501FastBoot ? WINC1501_FAST_RESET_WAIT_MS : WINC1501_RESET_WAIT_MS);
 	}
 }
 
@@ -179,6 +216,31 @@ void nm_bsp_sleep(uint32 u32TimeMsec)
 	}
 }
 
+/*
+ *	@fn		nm_bsp_sleep_us
+ *	@brief	Sleep in units of uSec
+ *	@param[IN]	u32TimeUsec
+ *				Time in microseconds
+ */
+void nm_bsp_sleep_us(uint32 u32TimeUsec)
+{
+	/* delayMicroseconds() is only accurate up to 16383 us */
+	while (u32TimeUsec > 1000) {
+		delayMicroseconds(1000);
+		u32TimeUsec -= 1000;
+	}
+	delayMicroseconds(u32TimeUsec);
+}
+
+/*
+ *	@fn		nm_bsp_time_us
+ *	@brief	Free running microsecond counter
+ */
+uint32 nm_bsp_time_us(void)
+{
+	return micros();
+}
+
 /*
  *	@fn		nm_bsp_register_isr
  *	@brief	Register interrupt service routine
@@ -192,6 +254,8 @@ void nm_bsp_sleep(uint32 u32TimeMsec)
 void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
 {
 	gpfIsr = pfIsr;
+	gu8IsrMasked = 0;
+	gu8IsrPending = 0;
 	attachInterruptMultiArch(gi8Winc1501IntnPin, chip_isr, FALLING);
 }
 
@@ -207,8 +271,28 @@ void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
 void nm_bsp_interrupt_ctrl(uint8 u8Enable)
 {
 	if (u8Enable) {
-		attachInterruptMultiArch(gi8Winc1501IntnPin, chip_isr, FALLING);
+		/* The caller may already run with interrupts disabled, keep it that way */
+#if defined(__AVR__)
+		uint8_t u8State = SREG;
+#elif defined(__arm__)
+		uint32_t u32State = __get_PRIMASK();
+#endif
+
+		noInterrupts();
+		gu8IsrMasked = 0;
+		if (gu8IsrPending) {
+			/* Deliver the edge seen while masked, as the ISR would have */
+			gu8IsrPending = 0;
+			chip_isr();
+		}
+#if defined(__AVR__)
+		SREG = u8State;
+#elif defined(__arm__)
+		__set_PRIMASK(u32State);
+#else
+		interrupts();
+#endif
 	} else {
-		detachInterruptMultiArch(gi8Winc1501IntnPin);
+		gu8IsrMasked = 1;
 	}
 }
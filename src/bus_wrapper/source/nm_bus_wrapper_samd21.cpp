@@ -129,8 +129,10 @@ sint8 nm_bus_init(void * /* pvInitValue */)
 	pinMode(gi8Winc1501CsPin, OUTPUT);
 	digitalWrite(gi8Winc1501CsPin, HIGH);
 
-	/* Reset WINC1500. */
-	nm_bsp_reset();
+	/* Reset WINC1500, already done by the BSP when booting fast or async. */
+	if (!gu8Winc1501FastBoot && !gu8Winc1501AsyncReset) {
+		nm_bsp_reset();
+	}
 	nm_bsp_sleep(1);
 
 	return result;
@@ -188,6 +188,69 @@ sint8 m2m_crypto_sha256_hash_update(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Da
 sint8 m2m_crypto_sha256_hash_finish(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Sha256Digest);
 
 
+/*!
+@fn	\
+	sint8 m2m_crypto_sha256_hash_feed(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Data, uint32 u32DataLength, uint32 *pu32Consumed);
+	
+@brief	Non blocking SHA256 hash update
+
+	Data is uploaded to the WINC while the engine hashes the previous upload. The function returns
+	instead of waiting for the engine, with the part of the data that could not be taken yet.
+
+@param [in]	psha256Ctxt
+				Pointer to the sha256 context.
+				
+@param [in]	pu8Data
+				Buffer holding the data submitted to the hash.
+				
+@param [in]	u32DataLength
+				Size of the data buffer in bytes.
+
+@param [out]	pu32Consumed
+				Number of bytes taken from the buffer.
+
+@see m2m_crypto_sha256_hash_poll
+
+@return		
+	@ref M2M_SUCCESS when all the data was taken, @ref M2M_NOT_YET when the rest must be submitted again later,
+	and a negative value otherwise.
+*/
+sint8 m2m_crypto_sha256_hash_feed(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Data, uint32 u32DataLength, uint32 *pu32Consumed);
+
+
+/*!
+@fn	\
+	sint8 m2m_crypto_sha256_hash_poll(tstrM2mSha256Ctxt *psha256Ctxt);
+	
+@brief	SHA256 engine progress, starts the next uploaded data when the engine is free.
+
+@param [in]	psha256Ctxt
+				Pointer to the sha256 context.
+				
+@return		
+	@ref M2M_SUCCESS when all the submitted data is hashed, @ref M2M_NOT_YET while the engine is busy.
+*/
+sint8 m2m_crypto_sha256_hash_poll(tstrM2mSha256Ctxt *psha256Ctxt);
+
+
+/*!
+@fn	\
+	sint8 m2m_crypto_sha256_hash_final(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Sha256Digest);
+	
+@brief	Non blocking SHA256 hash finalization, to be called until it no longer returns @ref M2M_NOT_YET.
+
+@param[in]	psha256Ctxt
+				Pointer to a sha256 context allocated by the caller.
+				
+@param [in] pu8Sha256Digest
+				Buffer allocated by the caller which will hold the resultant SHA256 Digest. It must be allocated no less than M2M_SHA256_DIGEST_LEN.
+				
+@return		
+	@ref M2M_SUCCESS once the digest is written, @ref M2M_NOT_YET while the engine is busy.
+*/
+sint8 m2m_crypto_sha256_hash_final(tstrM2mSha256Ctxt *psha256Ctxt, uint8 *pu8Sha256Digest);
+
+
 /*!
 @fn	\
 	sint8 m2m_rsa_sign_verify(uint8 *pu8N, uint16 u16NSize, uint8 *pu8E, uint16 u16ESize, uint8 *pu8SignedMsgHash, \
@@ -455,6 +455,21 @@ typedef void (*tpfAppEthCb) (uint8 u8MsgType, void * pvMsg,void * pvCtrlBuf);
 */
 typedef void (*tpfAppMonCb) (tstrM2MWifiRxPacketInfo *pstrWifiRxPacket, uint8 * pu8Payload, uint16 u16PayloadSize);
 
+/*!
+@typedef	\
+	tpfAppMonFilterCb
+
+@brief
+	Optional monitoring mode filter, called with the packet header parameters before the payload is read from the chip.
+@param [in]	pstrWifiRxPacket
+				Pointer to a structure holding the Wi-Fi packet header parameters.
+@return
+	Zero to drop the packet without reading its payload, the @ref tpfAppMonCb callback is then not called.
+@see
+	m2m_wifi_set_monitor_filter
+*/
+typedef uint8 (*tpfAppMonFilterCb) (tstrM2MWifiRxPacketInfo *pstrWifiRxPacket);
+
 /**
 @struct 	\
 	tstrEthInitParam
@@ -654,6 +669,41 @@ Following are the possible Wi-Fi events that are expected to be received through
 	The function returns @ref M2M_SUCCESS for successful operations and a negative value otherwise.
 */
 NMI_API sint8  m2m_wifi_init(tstrWifiInitParam * pWifiInitParam);
+ /**@}*/
+ /** @defgroup WiFiInitStartFn m2m_wifi_init_start
+ *  @ingroup WLANAPI
+ *   Non-blocking variant of @ref m2m_wifi_init. The bus is initialized and the function returns while the chip boots,
+ *   the boot is then advanced with @ref m2m_wifi_init_poll.
+ */
+ /**@{*/
+/*!
+@fn	\
+	NMI_API sint8  m2m_wifi_init_start(tstrWifiInitParam * pWifiInitParam);
+
+@param [in]	pWifiInitParam
+	Same as for @ref m2m_wifi_init.
+
+@pre
+	The chip reset must have been released.
+
+@see
+	m2m_wifi_init_poll
+
+@return
+	The function returns @ref M2M_SUCCESS for successful operations and a negative value otherwise.
+*/
+NMI_API sint8  m2m_wifi_init_start(tstrWifiInitParam * pWifiInitParam);
+/*!
+@fn	\
+	NMI_API sint8  m2m_wifi_init_poll(void);
+
+@brief Advance the initialization started with @ref m2m_wifi_init_start, without blocking.
+	Successive calls must be at least 2 ms apart.
+
+@return
+	M2M_NOT_YET while the chip boots, then the result @ref m2m_wifi_init would have returned.
+*/
+NMI_API sint8  m2m_wifi_init_poll(void);
  /**@}*/
  /** @defgroup WifiDeinitFn m2m_wifi_deinit
  *  @ingroup WLANAPI
@@ -2575,6 +2625,34 @@ NMI_API sint8 m2m_wifi_disable_monitoring_mode(void);
  */
 NMI_API sint8 m2m_wifi_send_wlan_pkt(uint8 *pu8WlanPacket, uint16 u16WlanHeaderLength, uint16 u16WlanPktSize);
 /**@}*/
+/** @defgroup SetMonitorBufferFn m2m_wifi_set_monitor_buffer
+ *   @ingroup WLANAPI
+ *    Synchronous function to change the monitoring mode payload buffer, usually from the @ref tpfAppMonCb callback
+ *    so that the next packet is received into another buffer.
+ *@{*/
+/*!
+ * @fn             NMI_API sint8 m2m_wifi_set_monitor_buffer(uint8 *, uint16);
+ * @param [in]     pu8PayloadBuffer
+ *                 Pointer to the buffer for the next packets. NULL causes a negative error @ref M2M_ERR_FAIL.
+ * @param [in]     u16BufferSize
+ *                 Size of the buffer. The offset given to @ref m2m_wifi_enable_monitoring_mode is kept.
+ * @see            m2m_wifi_enable_monitoring_mode
+ * @return         The function returns @ref M2M_SUCCESS for successful operations and a negative value otherwise.
+ */
+NMI_API sint8 m2m_wifi_set_monitor_buffer(uint8 *pu8PayloadBuffer, uint16 u16BufferSize);
+/**@}*/
+/** @defgroup SetMonitorFilterFn m2m_wifi_set_monitor_filter
+ *   @ingroup WLANAPI
+ *    Registers a host side filter for the monitoring mode, see @ref tpfAppMonFilterCb. Filtering on the host avoids
+ *    reading the payload of rejected packets over SPI. It is cleared by @ref m2m_wifi_disable_monitoring_mode.
+ *@{*/
+/*!
+ * @fn             NMI_API void m2m_wifi_set_monitor_filter(tpfAppMonFilterCb);
+ * @param [in]     pfFilterCb
+ *                 The filter, or NULL to pass every packet to the @ref tpfAppMonCb callback.
+ */
+NMI_API void m2m_wifi_set_monitor_filter(tpfAppMonFilterCb pfFilterCb);
+/**@}*/
 /** @defgroup WifiSendEthernetPktFn m2m_wifi_send_ethernet_pkt
  *   @ingroup WLANAPI
  *   Synchronous function to transmit an Ethernet packet. Transmit a packet directly in ETHERNET/bypass mode where the TCP/IP stack is disabled and the implementation of this packet is left to the application developer. 
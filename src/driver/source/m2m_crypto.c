@@ -46,6 +46,7 @@ INCLUDES
 #include "driver/include/m2m_crypto.h"
 #include "driver/source/nmbus.h"
 #include "driver/source/nmasic.h"
+#include "driver/source/m2m_hif.h"
 
 #ifdef CONF_CRYPTO_HW
 
@@ -61,6 +62,11 @@ MACROS
 
 #define SHARED_MEM_BASE											(0xd0000)
 
+/* Double buffered SHA256 input, then the digest */
+#define SHA256_BUF_SIZE											(1024)
+#define SHA256_BUF_BLOCKS										(SHA256_BUF_SIZE / SHA_BLOCK_SIZE)
+#define SHA256_DIGEST_ADDR										(SHARED_MEM_BASE + 2 * SHA256_BUF_SIZE)
+
 
 #define SHA256_MEM_BASE											(0x180000UL)
 #define SHA256_ENGINE_ADDR										(0x180000ul)
@@ -187,12 +193,19 @@ DATA TYPES
 	tstrHashContext
 	
 @brief
+	Data is uploaded into one half of the shared memory while the engine
+	hashes the other half, at most one upload waits for the engine.
 */
 typedef struct{
 	uint32		au32HashState[M2M_SHA256_DIGEST_LEN/4];
 	uint8		au8CurrentBlock[64];
 	uint32		u32TotalLength;
 	uint8		u8InitHashFlag;
+	uint8		u8Busy;
+	uint8		u8Pending;
+	uint8		u8Half;
+	uint16		u16PendingBlocks;
+	uint8		u8Final;
 }tstrSHA256HashCtxt;
 
 
@@ -201,6 +214,36 @@ typedef struct{
 *           SHA256 IMPLEMENTATION           *
 *======*======*======*======*======*========*/
 
+static void sha256_start(tstrSHA256HashCtxt *pstrSHA256, uint32 u32Addr, uint32 u32NBlocks, uint8 u8WriteBack)
+{
+	uint32	u32RegVal = 0;
+
+	nm_write_reg(SHA256_CTRL, u32RegVal);
+	u32RegVal |= SHA256_CTRL_FORCE_SHA256_QUIT_MASK;
+	nm_write_reg(SHA256_CTRL, u32RegVal);
+
+	if(pstrSHA256->u8InitHashFlag)
+	{
+		pstrSHA256->u8InitHashFlag = 0;
+		u32RegVal |= SHA256_CTRL_INIT_SHA256_STATE_MASK;
+	}
+
+	nm_write_reg(SHA256_DATA_LENGTH, (u32NBlocks * SHA_BLOCK_SIZE));
+	nm_write_reg(SHA256_START_RD_ADDR, u32Addr);
+	nm_write_reg(SHA256_START_WR_ADDR, SHA256_DIGEST_ADDR);
+
+	u32RegVal |= SHA256_CTRL_START_CALC_MASK;
+	if(u8WriteBack)
+	{
+		u32RegVal |= SHA256_CTRL_WR_BACK_HASH_VALUE_MASK;
+	}
+	u32RegVal &= ~(0x7UL << 8);
+	u32RegVal |= (0x2UL << 8);
+
+	nm_write_reg(SHA256_CTRL, u32RegVal);
+	pstrSHA256->u8Busy = 1;
+}
+
 sint8 m2m_crypto_sha256_hash_init(tstrM2mSha256Ctxt *pstrSha256Ctxt)
 {
 	tstrSHA256HashCtxt	*pstrSHA256 = (tstrSHA256HashCtxt*)pstrSha256Ctxt;
@@ -212,127 +255,161 @@ sint8 m2m_crypto_sha256_hash_init(tstrM2mSha256Ctxt *pstrSha256Ctxt)
 	return 0;
 }
 
-sint8 m2m_crypto_sha256_hash_update(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Data, uint16 u16DataLength)
+/* The sha256_* steps expect the chip to be awake. */
+static sint8 sha256_poll(tstrSHA256HashCtxt *pstrSHA256)
 {
-	sint8	s8Ret = M2M_ERR_FAIL;
-	tstrSHA256HashCtxt	*pstrSHA256 = (tstrSHA256HashCtxt*)pstrSha256Ctxt;
-	if(pstrSHA256 != NULL)
+	if(pstrSHA256->u8Busy)
+	{
+		if(!(nm_read_reg(SHA256_DONE_INTR_STS) & NBIT0))
+			return M2M_NOT_YET;
+		pstrSHA256->u8Busy = 0;
+	}
+	if(pstrSHA256->u8Pending)
 	{
-		uint32	u32ReadAddr;
-		uint32	u32WriteAddr	= SHARED_MEM_BASE;
-		uint32	u32Addr			= u32WriteAddr;
-		uint32 	u32ResidualBytes;
-		uint32 	u32NBlocks;
-		uint32 	u32Offset;
-		uint32 	u32CurrentBlock = 0;
-		uint8	u8IsDone		= 0;
+		/* The other half was uploaded meanwhile */
+		pstrSHA256->u8Pending = 0;
+		sha256_start(pstrSHA256, SHARED_MEM_BASE + (pstrSHA256->u8Half ^ 1) * SHA256_BUF_SIZE,
+			pstrSHA256->u16PendingBlocks, 0);
+		return M2M_NOT_YET;
+	}
+	return M2M_SUCCESS;
+}
 
-		/* Get the remaining bytes from the previous update (if the length is not block aligned). */
-		u32ResidualBytes = pstrSHA256->u32TotalLength % SHA_BLOCK_SIZE;
+static sint8 sha256_feed(tstrSHA256HashCtxt *pstrSHA256, uint8 *pu8Data, uint32 u32DataLength, uint32 *pu32Consumed)
+{
+	uint32	u32Consumed = 0;
 
-		/* Update the total data length. */
-		pstrSHA256->u32TotalLength += u16DataLength;
+	while(u32DataLength != 0)
+	{
+		uint32	u32Addr;
+		uint32	u32ResidualBytes = pstrSHA256->u32TotalLength % SHA_BLOCK_SIZE;
+		uint32	u32NBlocks = 0;
+		uint32	u32Count;
 
-		if(u32ResidualBytes != 0)
+		if((u32ResidualBytes + u32DataLength) < SHA_BLOCK_SIZE)
 		{
-			if((u32ResidualBytes + u16DataLength) >= SHA_BLOCK_SIZE)
-			{
-				u32Offset = SHA_BLOCK_SIZE - u32ResidualBytes;
-				m2m_memcpy(&pstrSHA256->au8CurrentBlock[u32ResidualBytes], pu8Data, u32Offset);
-				pu8Data			+= u32Offset;
-				u16DataLength	-= u32Offset;
-
-				nm_write_block(u32Addr, pstrSHA256->au8CurrentBlock, SHA_BLOCK_SIZE);
-				u32Addr += SHA_BLOCK_SIZE;
-				u32CurrentBlock	 = 1;
-			}
-			else
-			{
-				m2m_memcpy(&pstrSHA256->au8CurrentBlock[u32ResidualBytes], pu8Data, u16DataLength);
-				u16DataLength = 0;
-			}
+			/* Less than a block, kept in the context */
+			m2m_memcpy(&pstrSHA256->au8CurrentBlock[u32ResidualBytes], pu8Data, u32DataLength);
+			pstrSHA256->u32TotalLength += u32DataLength;
+			u32Consumed += u32DataLength;
+			break;
 		}
 
-		/* Get the number of HASH BLOCKs and the residual bytes. */
-		u32NBlocks			= u16DataLength / SHA_BLOCK_SIZE;
-		u32ResidualBytes	= u16DataLength % SHA_BLOCK_SIZE;
+		sha256_poll(pstrSHA256);
+		if(pstrSHA256->u8Pending)
+		{
+			/* Both halves are in use */
+			break;
+		}
+		u32Addr = SHARED_MEM_BASE + pstrSHA256->u8Half * SHA256_BUF_SIZE;
 
-		if(u32NBlocks != 0)
+		if(u32ResidualBytes != 0)
 		{
-			nm_write_block(u32Addr, pu8Data, (uint16)(u32NBlocks * SHA_BLOCK_SIZE));
-			pu8Data += (u32NBlocks * SHA_BLOCK_SIZE);
+			u32Count = SHA_BLOCK_SIZE - u32ResidualBytes;
+			m2m_memcpy(&pstrSHA256->au8CurrentBlock[u32ResidualBytes], pu8Data, u32Count);
+			nm_write_block(u32Addr, pstrSHA256->au8CurrentBlock, SHA_BLOCK_SIZE);
+			pu8Data			+= u32Count;
+			u32DataLength	-= u32Count;
+			u32Consumed		+= u32Count;
+			pstrSHA256->u32TotalLength += u32Count;
+			u32NBlocks = 1;
 		}
 
-		u32NBlocks += u32CurrentBlock;
-		if(u32NBlocks != 0)
+		u32Count = u32DataLength / SHA_BLOCK_SIZE;
+		if(u32Count > SHA256_BUF_BLOCKS - u32NBlocks)
+		{
+			u32Count = SHA256_BUF_BLOCKS - u32NBlocks;
+		}
+		if(u32Count != 0)
 		{
-			uint32	u32RegVal = 0;
+			u32Count *= SHA_BLOCK_SIZE;
+			nm_write_block(u32Addr + u32NBlocks * SHA_BLOCK_SIZE, pu8Data, u32Count);
+			pu8Data			+= u32Count;
+			u32DataLength	-= u32Count;
+			u32Consumed		+= u32Count;
+			pstrSHA256->u32TotalLength += u32Count;
+			u32NBlocks += u32Count / SHA_BLOCK_SIZE;
+		}
 
-			nm_write_reg(SHA256_CTRL, u32RegVal);
-			u32RegVal |= SHA256_CTRL_FORCE_SHA256_QUIT_MASK;
-			nm_write_reg(SHA256_CTRL, u32RegVal);
+		pstrSHA256->u16PendingBlocks = (uint16)u32NBlocks;
+		pstrSHA256->u8Pending = 1;
+		pstrSHA256->u8Half ^= 1;
+		sha256_poll(pstrSHA256);
+	}
 
-			if(pstrSHA256->u8InitHashFlag)
-			{
-				pstrSHA256->u8InitHashFlag = 0;
-				u32RegVal |= SHA256_CTRL_INIT_SHA256_STATE_MASK;
-			}
+	*pu32Consumed = u32Consumed;
+	return (u32DataLength == 0) ? M2M_SUCCESS : M2M_NOT_YET;
+}
 
-			u32ReadAddr = u32WriteAddr + (u32NBlocks * SHA_BLOCK_SIZE);
-			nm_write_reg(SHA256_DATA_LENGTH, (u32NBlocks * SHA_BLOCK_SIZE));
-			nm_write_reg(SHA256_START_RD_ADDR, u32WriteAddr);
-			nm_write_reg(SHA256_START_WR_ADDR, u32ReadAddr);
+sint8 m2m_crypto_sha256_hash_poll(tstrM2mSha256Ctxt *pstrSha256Ctxt)
+{
+	sint8	s8Ret;
 
-			u32RegVal |= SHA256_CTRL_START_CALC_MASK;
+	if(pstrSha256Ctxt == NULL)
+		return M2M_ERR_FAIL;
 
-			u32RegVal &= ~(0x7 << 8);
-			u32RegVal |= (2 << 8);
+	s8Ret = hif_chip_wake();
+	if(s8Ret != M2M_SUCCESS)
+		return s8Ret;
+	s8Ret = sha256_poll((tstrSHA256HashCtxt*)pstrSha256Ctxt);
+	hif_chip_sleep();
+	return s8Ret;
+}
 
-			nm_write_reg(SHA256_CTRL, u32RegVal);
+sint8 m2m_crypto_sha256_hash_feed(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Data, uint32 u32DataLength, uint32 *pu32Consumed)
+{
+	sint8	s8Ret;
+	tstrSHA256HashCtxt	*pstrSHA256 = (tstrSHA256HashCtxt*)pstrSha256Ctxt;
 
-			/* 5.	Wait for done_intr */
-			while(!u8IsDone)
-			{
-				u32RegVal = nm_read_reg(SHA256_DONE_INTR_STS);
-				u8IsDone = u32RegVal & NBIT0;
-			}
-		}
-		if(u32ResidualBytes != 0)
-		{
-			m2m_memcpy(pstrSHA256->au8CurrentBlock, pu8Data, u32ResidualBytes);
-		}
-		s8Ret = M2M_SUCCESS;
-	}
+	if((pstrSHA256 == NULL) || (pu32Consumed == NULL) || pstrSHA256->u8Final)
+		return M2M_ERR_FAIL;
+
+	/* Data completing no block stays in the context, no need to wake the chip */
+	if(((pstrSHA256->u32TotalLength % SHA_BLOCK_SIZE) + u32DataLength) < SHA_BLOCK_SIZE)
+		return sha256_feed(pstrSHA256, pu8Data, u32DataLength, pu32Consumed);
+
+	s8Ret = hif_chip_wake();
+	if(s8Ret != M2M_SUCCESS)
+		return s8Ret;
+	s8Ret = sha256_feed(pstrSHA256, pu8Data, u32DataLength, pu32Consumed);
+	hif_chip_sleep();
 	return s8Ret;
 }
 
+sint8 m2m_crypto_sha256_hash_update(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Data, uint16 u16DataLength)
+{
+	sint8	s8Ret;
+	uint32	u32Consumed;
+	uint32	u32DataLength = u16DataLength;
 
-sint8 m2m_crypto_sha256_hash_finish(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Sha256Digest)
+	do
+	{
+		s8Ret = m2m_crypto_sha256_hash_feed(pstrSha256Ctxt, pu8Data, u32DataLength, &u32Consumed);
+		if(s8Ret < 0)
+			return s8Ret;
+		pu8Data			+= u32Consumed;
+		u32DataLength	-= u32Consumed;
+	} while(s8Ret == M2M_NOT_YET);
+
+	/* 5.	Wait for done_intr */
+	while((s8Ret = m2m_crypto_sha256_hash_poll(pstrSha256Ctxt)) == M2M_NOT_YET);
+	return s8Ret;
+}
+
+static sint8 sha256_final(tstrSHA256HashCtxt *pstrSHA256, uint8 *pu8Sha256Digest)
 {
-	sint8	s8Ret = M2M_ERR_FAIL;
-	tstrSHA256HashCtxt	*pstrSHA256 = (tstrSHA256HashCtxt*)pstrSha256Ctxt;
-	if(pstrSHA256 != NULL)
+	sint8	s8Ret;
+
+	s8Ret = sha256_poll(pstrSHA256);
+	if(s8Ret != M2M_SUCCESS)
+		return s8Ret;
+
+	if(!pstrSHA256->u8Final)
 	{
-		uint32	u32ReadAddr;
-		uint32	u32WriteAddr	= SHARED_MEM_BASE;
-		uint32	u32Addr			= u32WriteAddr;
+		uint32	u32Addr		= SHARED_MEM_BASE;
 		uint16	u16Offset;
 		uint16 	u16PaddingLength;
-		uint16	u16NBlocks		= 1;
-		uint32	u32RegVal		= 0;
-		uint32	u32Idx,u32ByteIdx;
-		uint32	au32Digest[M2M_SHA256_DIGEST_LEN / 4];
-		uint8	u8IsDone		= 0;
-
-		nm_write_reg(SHA256_CTRL,u32RegVal);
-		u32RegVal |= SHA256_CTRL_FORCE_SHA256_QUIT_MASK;
-		nm_write_reg(SHA256_CTRL,u32RegVal);
-
-		if(pstrSHA256->u8InitHashFlag)
-		{
-			pstrSHA256->u8InitHashFlag = 0;
-			u32RegVal |= SHA256_CTRL_INIT_SHA256_STATE_MASK;
-		}
+		uint16	u16NBlocks	= 1;
 
 		/* Calculate the offset of the last data byte in the current block. */
 		u16Offset = (uint16)(pstrSHA256->u32TotalLength % SHA_BLOCK_SIZE);
@@ -357,30 +434,21 @@ sint8 m2m_crypto_sha256_hash_finish(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu
 			u16NBlocks ++;
 		}
 
-		/* pack the length at the end of the padding block */
+		/* pack the length in bits at the end of the padding block */
+		PUTU32(pstrSHA256->u32TotalLength >> 29, pstrSHA256->au8CurrentBlock, (SHA_BLOCK_SIZE - 8));
 		PUTU32(pstrSHA256->u32TotalLength << 3, pstrSHA256->au8CurrentBlock, (SHA_BLOCK_SIZE - 4));
 
-		u32ReadAddr = u32WriteAddr + (u16NBlocks * SHA_BLOCK_SIZE);
 		nm_write_block(u32Addr, pstrSHA256->au8CurrentBlock, SHA_BLOCK_SIZE);
-		nm_write_reg(SHA256_DATA_LENGTH, (u16NBlocks * SHA_BLOCK_SIZE));
-		nm_write_reg(SHA256_START_RD_ADDR, u32WriteAddr);
-		nm_write_reg(SHA256_START_WR_ADDR, u32ReadAddr);
-
-		u32RegVal |= SHA256_CTRL_START_CALC_MASK;
-		u32RegVal |= SHA256_CTRL_WR_BACK_HASH_VALUE_MASK;
-		u32RegVal &= ~(0x7UL << 8);
-		u32RegVal |= (0x2UL << 8);
-
-		nm_write_reg(SHA256_CTRL,u32RegVal);
-
+		sha256_start(pstrSHA256, SHARED_MEM_BASE, u16NBlocks, 1);
+		pstrSHA256->u8Final = 1;
+		return M2M_NOT_YET;
+	}
+	else
+	{
+		uint32	u32Idx,u32ByteIdx;
+		uint32	au32Digest[M2M_SHA256_DIGEST_LEN / 4];
 
-		/* 5.	Wait for done_intr */
-		while(!u8IsDone)
-		{
-			u32RegVal = nm_read_reg(SHA256_DONE_INTR_STS);
-			u8IsDone = u32RegVal & NBIT0;
-		}
-		nm_read_block(u32ReadAddr, (uint8*)au32Digest, 32);
+		nm_read_block(SHA256_DIGEST_ADDR, (uint8*)au32Digest, 32);
 		
 		/* Convert the output words to an array of bytes.
 		*/
@@ -392,11 +460,37 @@ sint8 m2m_crypto_sha256_hash_finish(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu
 			pu8Sha256Digest[u32ByteIdx ++] = BYTE_1(au32Digest[u32Idx]);
 			pu8Sha256Digest[u32ByteIdx ++] = BYTE_0(au32Digest[u32Idx]);
 		}
-		s8Ret = M2M_SUCCESS;
+		pstrSHA256->u8Final = 0;
+		return M2M_SUCCESS;
 	}
+}
+
+sint8 m2m_crypto_sha256_hash_final(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Sha256Digest)
+{
+	sint8	s8Ret;
+
+	if((pstrSha256Ctxt == NULL) || (pu8Sha256Digest == NULL))
+		return M2M_ERR_FAIL;
+
+	s8Ret = hif_chip_wake();
+	if(s8Ret != M2M_SUCCESS)
+		return s8Ret;
+	s8Ret = sha256_final((tstrSHA256HashCtxt*)pstrSha256Ctxt, pu8Sha256Digest);
+	hif_chip_sleep();
 	return s8Ret;
 }
 
+sint8 m2m_crypto_sha256_hash_finish(tstrM2mSha256Ctxt *pstrSha256Ctxt, uint8 *pu8Sha256Digest)
+{
+	sint8	s8Ret;
+
+	if(pstrSha256Ctxt == NULL)
+		return M2M_ERR_FAIL;
+
+	/* 5.	Wait for done_intr */
+	while((s8Ret = m2m_crypto_sha256_hash_final(pstrSha256Ctxt, pu8Sha256Digest)) == M2M_NOT_YET);
+	return s8Ret;
+}
 
 /*======*======*======*======*======*=======*
 *             RSA IMPLEMENTATION            *
@@ -434,6 +528,9 @@ void BigInt_ModExp
 	uint16	u16XSizeWords,u16ESizeWords;
 	uint32	u32Exponent;
 
+	if(hif_chip_wake() != M2M_SUCCESS)
+		return;
+
 	u16XSizeWords = (u16XSize + 3) / 4;
 	u16ESizeWords = (u16ESize + 3) / 4;
 	
@@ -514,6 +611,7 @@ void BigInt_ModExp
 	nm_write_reg(BIGINT_IRQ_STS,0);
 	m2m_memset(au8Tmp, 0, sizeof(au8Tmp));
 	nm_read_block(u32RAddr, au8Tmp, u16RSize);
+	hif_chip_sleep();
 	FlipBuffer(au8Tmp, pu8R, u16RSize);
 }
 
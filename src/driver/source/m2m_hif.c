@@ -70,7 +70,10 @@ typedef struct {
  	uint8 u8ChipMode;
  	uint8 u8ChipSleep;
  	uint8 u8HifRXDone;
- 	uint8 u8Interrupt;
+ 	uint8 u8IntRaised;
+ 	uint8 u8IntServed;
+ 	uint8 u8ChipAwake;
+ 	uint32 u32LastAccess;
  	uint32 u32RxAddr;
  	uint32 u32RxSize;
 	tpfHifCallBack pfWifiCb;
@@ -83,13 +86,19 @@ typedef struct {
 }tstrHifContext;
 
 volatile tstrHifContext gstrHifCxt;
+static uint32 gu32HoldAwakeUs = 0;
+static tstrHifWakeStats gstrWakeStats;
 #ifdef ARDUINO
 volatile uint8 hif_receive_blocked = 0;
 #endif
 
+/*
+* Pending interrupts are u8IntRaised - u8IntServed. Each counter has a single
+* writer, the ISR or hif_handle_isr, so no read-modify-write is shared.
+*/
 static void isr(void)
 {
-	gstrHifCxt.u8Interrupt++;
+	gstrHifCxt.u8IntRaised++;
 #ifdef NM_LEVEL_INTERRUPT
 	nm_bsp_interrupt_ctrl(0);
 #endif
@@ -159,10 +168,28 @@ sint8 hif_chip_wake(void)
 	}
 	if(gstrHifCxt.u8ChipSleep == 0)
 	{
-		if(gstrHifCxt.u8ChipMode != M2M_NO_PS)
+		if((gstrHifCxt.u8ChipMode != M2M_NO_PS) && (!gstrHifCxt.u8ChipAwake))
 		{
+			uint32 u32Start = nm_bsp_time_us();
+			uint32 u32Time;
+			uint8 u8Bucket = 0;
+
 			ret = chip_wake();
 			if(ret != M2M_SUCCESS)goto ERR1;
+
+			u32Time = nm_bsp_time_us() - u32Start;
+			gstrWakeStats.u32WakeCount++;
+			gstrWakeStats.u32WakeTimeUs += u32Time;
+			if(u32Time > gstrWakeStats.u32WakeMaxUs)
+			{
+				gstrWakeStats.u32WakeMaxUs = u32Time;
+			}
+			while((u8Bucket < HIF_WAKE_HIST_SIZE - 1) && (u32Time >= (64ul << u8Bucket)))
+			{
+				u8Bucket++;
+			}
+			gstrWakeStats.au32WakeHist[u8Bucket]++;
+			gstrHifCxt.u8ChipAwake = 1;
 		}
 		else
 		{
@@ -239,9 +266,17 @@ sint8 hif_chip_sleep(void)
 	{
 		if(gstrHifCxt.u8ChipMode != M2M_NO_PS)
 		{
-			ret = chip_sleep();
-			if(ret != M2M_SUCCESS)goto ERR1;
-
+			if(gu32HoldAwakeUs)
+			{
+				/* hif_handle_isr puts the chip to sleep once the hold window has passed */
+				gstrHifCxt.u32LastAccess = nm_bsp_time_us();
+			}
+			else
+			{
+				ret = chip_sleep();
+				if(ret != M2M_SUCCESS)goto ERR1;
+				gstrHifCxt.u8ChipAwake = 0;
+			}
 		}
 		else
 		{
@@ -251,6 +286,37 @@ ERR1:
 	return ret;
 }
 /**
+*	@fn		static sint8 hif_chip_sleep_idle(void);
+*	@brief	Put a held awake chip to sleep once it has been idle for the hold window.
+*/
+static sint8 hif_chip_sleep_idle(void)
+{
+	sint8 ret = M2M_SUCCESS;
+
+	if((gstrHifCxt.u8ChipAwake) && (gstrHifCxt.u8ChipSleep == 0) && (!gstrHifCxt.u8HifRXDone))
+	{
+		if((nm_bsp_time_us() - gstrHifCxt.u32LastAccess) >= gu32HoldAwakeUs)
+		{
+			ret = chip_sleep();
+			if(ret == M2M_SUCCESS)
+			{
+				gstrHifCxt.u8ChipAwake = 0;
+			}
+		}
+	}
+	return ret;
+}
+
+void hif_set_hold_awake(uint32 u32TimeMsec)
+{
+	gu32HoldAwakeUs = u32TimeMsec * 1000;
+}
+
+void hif_get_wake_stats(tstrHifWakeStats *pstrStats)
+{
+	m2m_memcpy((uint8*)pstrStats, (uint8*)&gstrWakeStats, sizeof(tstrHifWakeStats));
+}
+/**
 *   @fn		NMI_API sint8 hif_init(void * arg);
 *   @brief	To initialize HIF layer.
 *   @param [in]	arg
@@ -264,6 +330,7 @@ sint8 hif_init(void * arg)
 	(void)arg; // Silence "unused" warning
 #endif
 	m2m_memset((uint8*)&gstrHifCxt,0,sizeof(tstrHifContext));
+	m2m_memset((uint8*)&gstrWakeStats,0,sizeof(tstrHifWakeStats));
 	nm_bsp_register_isr(isr);
 	hif_register_cb(M2M_REQ_GROUP_HIF,m2m_hif_cb);
 	return M2M_SUCCESS;
@@ -636,10 +703,14 @@ sint8 hif_handle_isr(void)
 	}
 #endif
 
-	while (gstrHifCxt.u8Interrupt) {
+	if (gstrHifCxt.u8IntRaised == gstrHifCxt.u8IntServed) {
+		return hif_chip_sleep_idle();
+	}
+
+	while (gstrHifCxt.u8IntRaised != gstrHifCxt.u8IntServed) {
 		/*must be at that place because of the race of interrupt increment and that decrement*/
 		/*when the interrupt enabled*/
-		gstrHifCxt.u8Interrupt--;
+		gstrHifCxt.u8IntServed++;
 		while(1)
 		{
 			ret = hif_isr();
@@ -216,6 +216,48 @@ NMI_API void hif_set_sleep_mode(uint8 u8Pstype);
 
 NMI_API uint8 hif_get_sleep_mode(void);
 
+#define HIF_WAKE_HIST_SIZE	(8)
+/*!< Number of buckets in the wake up latency histogram */
+
+/*!
+@struct	\
+	tstrHifWakeStats
+
+@brief
+	Chip wake up statistics of the HIF layer, since hif_init.
+*/
+typedef struct {
+	uint32 u32WakeCount;
+	/*!< Number of chip_wake calls */
+	uint32 u32WakeTimeUs;
+	/*!< Total time spent waking the chip */
+	uint32 u32WakeMaxUs;
+	/*!< Longest single wake up */
+	uint32 au32WakeHist[HIF_WAKE_HIST_SIZE];
+	/*!< Wake ups by latency, bucket i counts those under (64 << i) us and the last one all longer */
+} tstrHifWakeStats;
+
+/*!
+@fn	\
+	NMI_API void hif_set_hold_awake(uint32 u32TimeMsec);
+
+@brief
+	Keep the chip awake for a while after the last HIF access in power save modes.
+	The chip is put to sleep by hif_handle_isr once the window has passed.
+
+@param [in]	u32TimeMsec
+				Hold awake window, 0 to sleep right after each access.
+*/
+NMI_API void hif_set_hold_awake(uint32 u32TimeMsec);
+/*!
+@fn	\
+	NMI_API void hif_get_wake_stats(tstrHifWakeStats *pstrStats);
+
+@brief
+	Get the chip wake up statistics.
+*/
+NMI_API void hif_get_wake_stats(tstrHifWakeStats *pstrStats);
+
 #ifdef CORTUS_APP
 /**
 *	@fn		hif_Resp_handler(uint8 *pu8Buffer, uint16 u16BufferSize)
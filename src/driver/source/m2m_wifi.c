@@ -56,8 +56,13 @@ static uint16 	        gu16ethRcvBufSize ;
 
 
 //#define CONF_MGMT
+#if defined(ARDUINO) && !defined(LIMITED_RAM_DEVICE)
+/* Monitoring mode for WiFiSniffer, the frame type enums stay out of the sketch namespace */
+#define CONF_MGMT
+#endif
 #ifdef CONF_MGMT
 static tpfAppMonCb  gpfAppMonCb  = NULL;
+static tpfAppMonFilterCb gpfAppMonFilterCb = NULL;
 static struct _tstrMgmtCtrl
 {
 	uint8* pu8Buf;
@@ -242,7 +247,7 @@ static void m2m_wifi_cb(uint8 u8OpCode, uint16 u16DataSize, uint32 u32Addr)
 		{
 			uint8 u8SetRxDone;
 			tstrM2mIpRsvdPkt strM2mRsvd;
-			if(hif_receive(u32Addr, &strM2mRsvd ,sizeof(tstrM2mIpRsvdPkt), 0) == M2M_SUCCESS)
+			if(hif_receive(u32Addr, (uint8*)&strM2mRsvd ,sizeof(tstrM2mIpRsvdPkt), 0) == M2M_SUCCESS)
 			{
 				tstrM2mIpCtrlBuf  strM2mIpCtrlBuf;
 				uint16 u16Offset = strM2mRsvd.u16PktOffset;
@@ -285,10 +290,17 @@ static void m2m_wifi_cb(uint8 u8OpCode, uint16 u16DataSize, uint32 u32Addr)
 		if(u16DataSize >= sizeof(tstrM2MWifiRxPacketInfo)) {
 			if(hif_receive(u32Addr, (uint8*)&strRxPacketInfo, sizeof(tstrM2MWifiRxPacketInfo), 0) == M2M_SUCCESS)
 			{
+				if(gpfAppMonFilterCb && !gpfAppMonFilterCb(&strRxPacketInfo))
+				{
+					/* Rejected before the payload is read out of the chip */
+					hif_receive(0, NULL, 0, 1);
+					return;
+				}
 				u16DataSize -= sizeof(tstrM2MWifiRxPacketInfo);
+				u16DataSize = (u16DataSize > gstrMgmtCtrl.u16Offset) ? (u16DataSize - gstrMgmtCtrl.u16Offset) : 0;
 				if(u16DataSize > 0 && gstrMgmtCtrl.pu8Buf != NULL)
 				{
-					if(u16DataSize > (gstrMgmtCtrl.u16Sz + gstrMgmtCtrl.u16Offset))
+					if(u16DataSize > gstrMgmtCtrl.u16Sz)
 					{
 						u16DataSize = gstrMgmtCtrl.u16Sz;
 					}
@@ -458,15 +470,10 @@ sint8 m2m_wifi_send_crl(tstrTlsCrlInfo* pCRL)
 	return s8Ret;
 }
 
-sint8 m2m_wifi_init(tstrWifiInitParam * param)
+static sint8 m2m_wifi_init_param(tstrWifiInitParam * param, uint8 * pu8WifiMode)
 {
-	tstrM2mRev strtmp;
-	sint8 ret = M2M_SUCCESS;
-	uint8 u8WifiMode = M2M_WIFI_MODE_NORMAL;
-	
 	if(param == NULL) {
-		ret = M2M_ERR_FAIL;
-		goto _EXIT0;
+		return M2M_ERR_FAIL;
 	}
 	
 	gpfAppWifiCb = param->pfAppWifiCb;
@@ -475,16 +482,24 @@ sint8 m2m_wifi_init(tstrWifiInitParam * param)
 	gpfAppEthCb  	    = param->strEthInitParam.pfAppEthCb;
 	gau8ethRcvBuf       = param->strEthInitParam.au8ethRcvBuf;
 	gu16ethRcvBufSize	= param->strEthInitParam.u16ethRcvBufSize;
-	u8WifiMode = param->strEthInitParam.u8EthernetEnable;
+	*pu8WifiMode = param->strEthInitParam.u8EthernetEnable;
+#else
+	(void)pu8WifiMode;
 #endif /* ETH_MODE */
 
 #ifdef CONF_MGMT
 	gpfAppMonCb  = param->pfAppMonCb;
 #endif
 	gu8scanInProgress = 0;
-	/* Apply device specific initialization. */
-	ret = nm_drv_init(&u8WifiMode);
-	if(ret != M2M_SUCCESS) 	goto _EXIT0;
+	return M2M_SUCCESS;
+}
+
+/* Driver is up, start the host interface */
+static sint8 m2m_wifi_init_hif(void)
+{
+	tstrM2mRev strtmp;
+	sint8 ret = M2M_SUCCESS;
+
 	/* Initialize host interface module */
 	ret = hif_init(NULL);
 	if(ret != M2M_SUCCESS) 	goto _EXIT1;
@@ -518,6 +533,43 @@ _EXIT0:
 	return ret;
 }
 
+sint8 m2m_wifi_init(tstrWifiInitParam * param)
+{
+	sint8 ret = M2M_SUCCESS;
+	uint8 u8WifiMode = M2M_WIFI_MODE_NORMAL;
+	
+	ret = m2m_wifi_init_param(param, &u8WifiMode);
+	if(ret != M2M_SUCCESS) 	goto _EXIT0;
+	/* Apply device specific initialization. */
+	ret = nm_drv_init(&u8WifiMode);
+	if(ret != M2M_SUCCESS) 	goto _EXIT0;
+	ret = m2m_wifi_init_hif();
+_EXIT0:
+	return ret;
+}
+
+sint8 m2m_wifi_init_start(tstrWifiInitParam * param)
+{
+	sint8 ret = M2M_SUCCESS;
+	uint8 u8WifiMode = M2M_WIFI_MODE_NORMAL;
+
+	ret = m2m_wifi_init_param(param, &u8WifiMode);
+	if(ret != M2M_SUCCESS) 	goto _EXIT0;
+	ret = nm_drv_init_start(&u8WifiMode);
+_EXIT0:
+	return ret;
+}
+
+sint8 m2m_wifi_init_poll(void)
+{
+	sint8 ret = nm_drv_init_poll();
+
+	if(ret != M2M_SUCCESS) 	goto _EXIT0;
+	ret = m2m_wifi_init_hif();
+_EXIT0:
+	return ret;
+}
+
 sint8  m2m_wifi_deinit(void * arg)
 {
 #ifdef ARDUINO
@@ -530,12 +582,25 @@ sint8  m2m_wifi_deinit(void * arg)
 	return M2M_SUCCESS;
 }
 
+#ifdef ARDUINO
+/* Called after each event pump, the Arduino layer overrides it */
+void __attribute__((weak)) m2m_wifi_handle_events_done(void)
+{
+}
+#endif
+
 sint8 m2m_wifi_handle_events(void * arg)
 {
 #ifdef ARDUINO
+	sint8 ret;
+
 	(void)arg; // Silence "unused" warning
-#endif
+	ret = hif_handle_isr();
+	m2m_wifi_handle_events_done();
+	return ret;
+#else
 	return hif_handle_isr();
+#endif
 }
 
 sint8 m2m_wifi_default_connect(void)
@@ -1221,9 +1286,27 @@ sint8 m2m_wifi_enable_monitoring_mode(tstrM2MWifiMonitorModeCtrl *pstrMtrCtrl, u
 
 sint8 m2m_wifi_disable_monitoring_mode(void)
 {
+	gpfAppMonFilterCb = NULL;
 	return hif_send(M2M_REQ_GROUP_WIFI, M2M_WIFI_REQ_DISABLE_MONITORING, NULL, 0, NULL, 0,0);
 }
 
+sint8 m2m_wifi_set_monitor_buffer(uint8 *pu8PayloadBuffer, uint16 u16BufferSize)
+{
+	if(pu8PayloadBuffer == NULL)
+	{
+		M2M_ERR("Buffer NULL pointer\r\n");
+		return M2M_ERR_FAIL;
+	}
+	gstrMgmtCtrl.pu8Buf	= pu8PayloadBuffer;
+	gstrMgmtCtrl.u16Sz	= u16BufferSize;
+	return M2M_SUCCESS;
+}
+
+void m2m_wifi_set_monitor_filter(tpfAppMonFilterCb pfFilterCb)
+{
+	gpfAppMonFilterCb = pfFilterCb;
+}
+
 sint8 m2m_wifi_send_wlan_pkt(uint8 *pu8WlanPacket, uint16 u16WlanHeaderLength, uint16 u16WlanPktSize)
 {
 	sint8	s8Ret = -1;
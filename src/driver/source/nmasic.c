@@ -44,6 +44,9 @@
 #include "bsp/include/nm_bsp.h"
 #include "driver/source/nmasic.h"
 #include "driver/include/m2m_types.h"
+#ifdef ARDUINO
+#include "bsp/include/nm_bsp_arduino.h"
+#endif
 
 #define NMI_GLB_RESET_0				(NMI_PERIPH_REG_BASE + 0x400)
 #define NMI_INTR_REG_BASE			(NMI_PERIPH_REG_BASE + 0xa00)
@@ -64,7 +67,35 @@
 #else
 #define TIMEOUT						(0xfffffffful)
 #endif
-#define WAKUP_TRAILS_TIMEOUT		(4)
+/* chip_wake polls the clocks after 50 us, doubling up to 2 ms between polls */
+#define WAKUP_POLL_MIN_US			(50)
+#define WAKUP_POLL_MAX_US			(2000)
+#define WAKUP_TIMEOUT_US			(10000)
+
+/* Overall deadline for bootrom and firmware start when booting fast */
+#define FAST_BOOT_TIMEOUT_US		(4000000ul)
+
+static uint32 gu32BootStart;
+static uint32 gu32BootromTime;
+static uint32 gu32FirmwareTime;
+
+static uint8 fast_boot(void)
+{
+#ifdef ARDUINO
+	return gu8Winc1501FastBoot;
+#else
+	return 0;
+#endif
+}
+
+/* Fast boot checks the overall deadline, otherwise the poll count is limited */
+static uint8 boot_timed_out(uint32 *pu32Cnt, uint32 u32Limit)
+{
+	if(fast_boot()) {
+		return (nm_bsp_time_us() - gu32BootStart) > FAST_BOOT_TIMEOUT_US;
+	}
+	return ++(*pu32Cnt) > u32Limit;
+}
 
 sint8 chip_apply_conf(uint32 u32Conf)
 {
@@ -316,7 +347,8 @@ ERR1:
 sint8 chip_wake(void)
 {
 	sint8 ret = M2M_SUCCESS;
-	uint32 reg = 0, clk_status_reg = 0,trials = 0;
+	uint32 reg = 0, clk_status_reg = 0;
+	uint32 u32Poll = WAKUP_POLL_MIN_US, u32Waited = 0;
 
 	ret = nm_read_reg_with_ret(HOST_CORT_COMM, &reg);
 	if(ret != M2M_SUCCESS)goto _WAKE_EXIT;
@@ -347,14 +379,17 @@ sint8 chip_wake(void)
 		if(clk_status_reg & NBIT2) {
 			break;
 		}
-		nm_bsp_sleep(2);
-		trials++;
-		if(trials > WAKUP_TRAILS_TIMEOUT)
+		if(u32Waited >= WAKUP_TIMEOUT_US)
 		{
 			M2M_ERR("Failed to wakup the chip\n");
 			ret = M2M_ERR_TIME_OUT;
 			goto _WAKE_EXIT;
 		}
+		nm_bsp_sleep_us(u32Poll);
+		u32Waited += u32Poll;
+		if(u32Poll < WAKUP_POLL_MAX_US) {
+			u32Poll <<= 1;
+		}
 	}while(1);
 	
 	/*workaround sometimes spi fail to read clock regs after reading/writing clockless registers*/
@@ -401,16 +436,54 @@ sint8 chip_reset(void)
 	return ret;
 }
 
-sint8 wait_for_bootrom(uint8 arg)
+/* Hand the boot over from the bootrom to the firmware */
+static void start_firmware(uint8 arg)
 {
-	sint8 ret = M2M_SUCCESS;
-	uint32 reg = 0, cnt = 0;
 	uint32 u32GpReg1 = 0;
 	uint32 u32DriverVerInfo = M2M_MAKE_VERSION_INFO(M2M_RELEASE_VERSION_MAJOR_NO,\
 				M2M_RELEASE_VERSION_MINOR_NO, M2M_RELEASE_VERSION_PATCH_NO,\
 				M2M_RELEASE_VERSION_MAJOR_NO, M2M_RELEASE_VERSION_MINOR_NO,\
 				M2M_RELEASE_VERSION_PATCH_NO);
 
+	if(M2M_WIFI_MODE_ATE_HIGH == arg) {
+		nm_write_reg(NMI_REV_REG, M2M_ATE_FW_START_VALUE);
+		nm_write_reg(NMI_STATE_REG, NBIT20);
+	}else if(M2M_WIFI_MODE_ATE_LOW == arg) {
+		nm_write_reg(NMI_REV_REG, M2M_ATE_FW_START_VALUE);
+		nm_write_reg(NMI_STATE_REG, 0);
+	}else if(M2M_WIFI_MODE_ETHERNET == arg){
+		u32GpReg1 = rHAVE_ETHERNET_MODE_BIT;
+		nm_write_reg(NMI_STATE_REG, u32DriverVerInfo);
+	} else {
+		/*bypass this step*/
+		nm_write_reg(NMI_STATE_REG, u32DriverVerInfo);
+	}
+
+	if(REV(nmi_get_chipid()) >= REV_3A0){
+		chip_apply_conf(u32GpReg1 | rHAVE_USE_PMU_BIT);
+	} else {
+		chip_apply_conf(u32GpReg1);
+	}
+	M2M_INFO("DriverVerInfo: 0x%08lx\n",u32DriverVerInfo);
+
+	nm_write_reg(BOOTROM_REG,M2M_START_FIRMWARE);
+	gu32BootromTime = nm_bsp_time_us() - gu32BootStart;
+}
+
+void chip_boot_begin(void)
+{
+	gu32BootStart = nm_bsp_time_us();
+	gu32BootromTime = 0;
+	gu32FirmwareTime = 0;
+}
+
+sint8 wait_for_bootrom(uint8 arg)
+{
+	sint8 ret = M2M_SUCCESS;
+	uint32 reg = 0, cnt = 0;
+
+
+	chip_boot_begin();
 
 	reg = 0;
 	while(1) {
@@ -418,8 +491,14 @@ sint8 wait_for_bootrom(uint8 arg)
 		if (reg & 0x80000000) {
 			break;
 		}
+		if (boot_timed_out(&cnt, 0xfffffffful)) {
+			M2M_DBG("efuse loading timed out.\n");
+			ret = M2M_ERR_INIT;
+			goto ERR2;
+		}
 		nm_bsp_sleep(1); /* TODO: Why bus error if this delay is not here. */
 	}
+	cnt = 0;
 	reg = nm_read_reg(M2M_WAIT_FOR_HOST_REG);
 	reg &= 0x1;
 
@@ -432,7 +511,7 @@ sint8 wait_for_bootrom(uint8 arg)
 			nm_bsp_sleep(1);
 			reg = nm_read_reg(BOOTROM_REG);
 
-			if(++cnt > TIMEOUT)
+			if(boot_timed_out(&cnt, TIMEOUT))
 			{
 				M2M_DBG("failed to load firmware from flash.\n");
 				ret = M2M_ERR_INIT;
@@ -441,28 +520,7 @@ sint8 wait_for_bootrom(uint8 arg)
 		}
 	}
 	
-	if(M2M_WIFI_MODE_ATE_HIGH == arg) {
-		nm_write_reg(NMI_REV_REG, M2M_ATE_FW_START_VALUE);
-		nm_write_reg(NMI_STATE_REG, NBIT20);
-	}else if(M2M_WIFI_MODE_ATE_LOW == arg) {
-		nm_write_reg(NMI_REV_REG, M2M_ATE_FW_START_VALUE);
-		nm_write_reg(NMI_STATE_REG, 0);
-	}else if(M2M_WIFI_MODE_ETHERNET == arg){
-		u32GpReg1 = rHAVE_ETHERNET_MODE_BIT;
-		nm_write_reg(NMI_STATE_REG, u32DriverVerInfo);
-	} else {
-		/*bypass this step*/
-		nm_write_reg(NMI_STATE_REG, u32DriverVerInfo);
-	}
-
-	if(REV(nmi_get_chipid()) >= REV_3A0){
-		chip_apply_conf(u32GpReg1 | rHAVE_USE_PMU_BIT);
-	} else {
-		chip_apply_conf(u32GpReg1);
-	}
-	M2M_INFO("DriverVerInfo: 0x%08lx\n",u32DriverVerInfo);
-
-	nm_write_reg(BOOTROM_REG,M2M_START_FIRMWARE);
+	start_firmware(arg);
 
 #ifdef __ROM_TEST__
 	rom_test();
@@ -472,28 +530,36 @@ ERR2:
 	return ret;
 }
 
+static void firmware_start_check(uint8 arg, uint32 *pu32Reg, uint32 *pu32Value)
+{
+	if((M2M_WIFI_MODE_ATE_HIGH == arg)||(M2M_WIFI_MODE_ATE_LOW == arg)) {
+		*pu32Reg = NMI_REV_REG;
+		*pu32Value = M2M_ATE_FW_IS_UP_VALUE;
+	} else {
+		*pu32Reg = NMI_STATE_REG;
+		*pu32Value = M2M_FINISH_INIT_STATE;
+	}
+}
+
 sint8 wait_for_firmware_start(uint8 arg)
 {
 	sint8 ret = M2M_SUCCESS;
 	uint32 reg = 0, cnt = 0;
 	uint32 u32Timeout = TIMEOUT;
+	uint32 u32Start = nm_bsp_time_us();
 	volatile uint32 regAddress = NMI_STATE_REG;
 	volatile uint32 checkValue = M2M_FINISH_INIT_STATE;
 	
-	if((M2M_WIFI_MODE_ATE_HIGH == arg)||(M2M_WIFI_MODE_ATE_LOW == arg)) {
-		regAddress = NMI_REV_REG;
-		checkValue = M2M_ATE_FW_IS_UP_VALUE;
-	} else {
-		/*bypass this step*/
-	}
+	firmware_start_check(arg, (uint32 *)&regAddress, (uint32 *)&checkValue);
 	
 	
 	while (checkValue != reg)
 	{
-		nm_bsp_sleep(2); /* TODO: Why bus error if this delay is not here. */
+		/* Fast boot polls every millisecond against the overall boot deadline */
+		nm_bsp_sleep(fast_boot() ? 1 : 2); /* TODO: Why bus error if this delay is not here. */
 		M2M_DBG("%x %x %x\n",(unsigned int)nm_read_reg(0x108c),(unsigned int)nm_read_reg(0x108c),(unsigned int)nm_read_reg(0x14A0));
 		reg = nm_read_reg(regAddress);
-		if(++cnt >= u32Timeout)
+		if(boot_timed_out(&cnt, u32Timeout - 1))
 		{
 			M2M_DBG("Time out for wait firmware Run\n");
 			ret = M2M_ERR_INIT;
@@ -504,10 +570,48 @@ sint8 wait_for_firmware_start(uint8 arg)
 	{
 		nm_write_reg(NMI_STATE_REG, 0);
 	}
+	gu32FirmwareTime = nm_bsp_time_us() - u32Start;
 ERR:
 	return ret;
 }
 
+sint8 poll_for_bootrom(uint8 arg)
+{
+	uint32 reg;
+
+	if(!(nm_read_reg(0x1014) & 0x80000000)) {
+		return M2M_NOT_YET;
+	}
+	reg = nm_read_reg(M2M_WAIT_FOR_HOST_REG);
+	if(((reg & 0x1) == 0) && (nm_read_reg(BOOTROM_REG) != M2M_FINISH_BOOT_ROM)) {
+		return M2M_NOT_YET;
+	}
+	start_firmware(arg);
+	return M2M_SUCCESS;
+}
+
+sint8 poll_for_firmware_start(uint8 arg)
+{
+	uint32 regAddress, checkValue;
+
+	firmware_start_check(arg, &regAddress, &checkValue);
+	if(nm_read_reg(regAddress) != checkValue) {
+		return M2M_NOT_YET;
+	}
+	if(M2M_FINISH_INIT_STATE == checkValue)
+	{
+		nm_write_reg(NMI_STATE_REG, 0);
+	}
+	gu32FirmwareTime = nm_bsp_time_us() - gu32BootStart - gu32BootromTime;
+	return M2M_SUCCESS;
+}
+
+void chip_get_boot_times(uint32 *pu32BootromUs, uint32 *pu32FirmwareUs)
+{
+	*pu32BootromUs = gu32BootromTime;
+	*pu32FirmwareUs = gu32FirmwareTime;
+}
+
 sint8 chip_deinit(void)
 {
 	uint32 reg = 0;
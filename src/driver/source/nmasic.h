@@ -163,6 +163,27 @@ sint8 wait_for_bootrom(uint8);
 */
 sint8 wait_for_firmware_start(uint8);
 /*
+*	@fn		chip_boot_begin
+*	@brief	Start the boot timer, called before polling the bootrom
+*/
+void chip_boot_begin(void);
+/*
+*	@fn		poll_for_bootrom
+*	@brief	Non-blocking wait_for_bootrom, M2M_NOT_YET until the firmware is started
+*/
+sint8 poll_for_bootrom(uint8);
+/*
+*	@fn		poll_for_firmware_start
+*	@brief	Non-blocking wait_for_firmware_start, M2M_NOT_YET until the firmware is up
+*/
+sint8 poll_for_firmware_start(uint8);
+/*
+*	@fn		chip_get_boot_times
+*	@brief	Time in microseconds spent in the last wait_for_bootrom and
+*			wait_for_firmware_start, 0 if the phase did not complete
+*/
+void chip_get_boot_times(uint32 *pu32BootromUs, uint32 *pu32FirmwareUs);
+/*
 *	@fn		chip_deinit
 *	@brief	
 */
@@ -55,6 +55,13 @@
 	uint32 nmdrv_firm_ver = 0;
 #endif
 
+/* Overall deadline for a non-blocking boot, see nm_drv_init_poll */
+#define NM_DRV_BOOT_TIMEOUT_US	(4000000ul)
+
+static uint8 gu8DrvMode;
+static uint8 gu8DrvBootromDone;
+static uint32 gu32DrvBootStart;
+
 /**
 *	@fn		nm_get_firmware_info(tstrM2mRev* M2mRev)
 *	@brief	Get Firmware version info
@@ -276,21 +283,10 @@ ERR1:
 	return ret;
 }
 
-/*
-*	@fn		nm_drv_init
-*	@brief	Initialize NMC1000 driver
-*	@return	M2M_SUCCESS in case of success and Negative error code in case of failure
-*   @param [in]	arg
-*				Generic argument
-*	@author	M. Abdelmawla
-*	@date	15 July 2012
-*	@version	1.0
-*/
-sint8 nm_drv_init(void * arg)
+static uint8 nm_drv_get_mode(void * arg)
 {
-	sint8 ret = M2M_SUCCESS;
 	uint8 u8Mode;
-	
+
 	if(NULL != arg) {
 		u8Mode = *((uint8 *)arg);
 		if((u8Mode < M2M_WIFI_MODE_NORMAL)||(u8Mode >= M2M_WIFI_MODE_MAX)) {
@@ -299,7 +295,14 @@ sint8 nm_drv_init(void * arg)
 	} else {
 		u8Mode = M2M_WIFI_MODE_NORMAL;
 	}
-	
+	return u8Mode;
+}
+
+/* Bring up the bus and check the chip, ahead of the bootrom */
+static sint8 nm_drv_init_bus(void)
+{
+	sint8 ret = M2M_SUCCESS;
+
 	ret = nm_bus_iface_init(NULL);
 	if (M2M_SUCCESS != ret) {
 		M2M_ERR("[nmi start]: fail init bus\n");
@@ -336,16 +339,18 @@ sint8 nm_drv_init(void * arg)
 	/* Must do this after global reset to set SPI data packet size. */
 	nm_spi_init();
 #endif
-	ret = wait_for_bootrom(u8Mode);
-	if (M2M_SUCCESS != ret) {
-		goto ERR2;
-	}
-		
-	ret = wait_for_firmware_start(u8Mode);
-	if (M2M_SUCCESS != ret) {
-		goto ERR2;
-	}
-	
+	return ret;
+ERR2:
+	nm_bus_iface_deinit();
+ERR1:
+	return ret;
+}
+
+/* Firmware is up, enable its interrupts */
+static sint8 nm_drv_init_complete(uint8 u8Mode)
+{
+	sint8 ret = M2M_SUCCESS;
+
 	if((M2M_WIFI_MODE_ATE_HIGH == u8Mode)||(M2M_WIFI_MODE_ATE_LOW == u8Mode)) {
 		goto ERR1;
 	} else {
@@ -355,15 +360,101 @@ sint8 nm_drv_init(void * arg)
 	ret = enable_interrupts();
 	if (M2M_SUCCESS != ret) {
 		M2M_ERR("failed to enable interrupts..\n");
-		goto ERR2;
+		nm_bus_iface_deinit();
 	}
+ERR1:
 	return ret;
+}
+
+/*
+*	@fn		nm_drv_init
+*	@brief	Initialize NMC1000 driver
+*	@return	M2M_SUCCESS in case of success and Negative error code in case of failure
+*   @param [in]	arg
+*				Generic argument
+*	@author	M. Abdelmawla
+*	@date	15 July 2012
+*	@version	1.0
+*/
+sint8 nm_drv_init(void * arg)
+{
+	sint8 ret = M2M_SUCCESS;
+	uint8 u8Mode = nm_drv_get_mode(arg);
+	
+	ret = nm_drv_init_bus();
+	if (M2M_SUCCESS != ret) {
+		goto ERR1;
+	}
+	ret = wait_for_bootrom(u8Mode);
+	if (M2M_SUCCESS != ret) {
+		goto ERR2;
+	}
+		
+	ret = wait_for_firmware_start(u8Mode);
+	if (M2M_SUCCESS != ret) {
+		goto ERR2;
+	}
+	
+	return nm_drv_init_complete(u8Mode);
 ERR2:
 	nm_bus_iface_deinit();
 ERR1:
 	return ret;
 }
 
+/*
+*	@fn		nm_drv_init_start
+*	@brief	Start a non-blocking driver initialization, see nm_drv_init_poll
+*   @param [in]	arg
+*				Generic argument, as for nm_drv_init
+*	@return	M2M_SUCCESS in case of success and Negative error code in case of failure
+*/
+sint8 nm_drv_init_start(void * arg)
+{
+	sint8 ret;
+
+	gu8DrvMode = nm_drv_get_mode(arg);
+	gu8DrvBootromDone = 0;
+	ret = nm_drv_init_bus();
+	if (M2M_SUCCESS == ret) {
+		chip_boot_begin();
+		gu32DrvBootStart = nm_bsp_time_us();
+	}
+	return ret;
+}
+
+/*
+*	@fn		nm_drv_init_poll
+*	@brief	Advance the initialization started by nm_drv_init_start. Polls must be
+*			at least 2 ms apart, as in wait_for_firmware_start.
+*	@return	M2M_NOT_YET while the chip boots, then the nm_drv_init result
+*/
+sint8 nm_drv_init_poll(void)
+{
+	sint8 ret;
+
+	if (!gu8DrvBootromDone) {
+		ret = poll_for_bootrom(gu8DrvMode);
+		if (M2M_SUCCESS == ret) {
+			gu8DrvBootromDone = 1;
+			ret = M2M_NOT_YET;
+		}
+	} else {
+		ret = poll_for_firmware_start(gu8DrvMode);
+		if (M2M_SUCCESS == ret) {
+			return nm_drv_init_complete(gu8DrvMode);
+		}
+	}
+	if ((M2M_NOT_YET == ret) && (nm_bsp_time_us() - gu32DrvBootStart > NM_DRV_BOOT_TIMEOUT_US)) {
+		M2M_ERR("[nmi start]: boot timed out\n");
+		ret = M2M_ERR_INIT;
+	}
+	if (M2M_NOT_YET != ret) {
+		nm_bus_iface_deinit();
+	}
+	return ret;
+}
+
 /*
 *	@fn		nm_drv_deinit
 *	@brief	Deinitialize NMC1000 driver
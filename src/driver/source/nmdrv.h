@@ -119,6 +119,18 @@ sint8 nm_drv_init_download_mode(void);
 */
 sint8 nm_drv_init(void * arg);
 
+/*
+*	@fn		nm_drv_init_start
+*	@brief	Start a non-blocking nm_drv_init, completed by nm_drv_init_poll
+*/
+sint8 nm_drv_init_start(void * arg);
+
+/*
+*	@fn		nm_drv_init_poll
+*	@brief	Advance nm_drv_init_start, M2M_NOT_YET until done
+*/
+sint8 nm_drv_init_poll(void);
+
 /**
 *	@fn		nm_drv_deinit
 *	@brief	Deinitialize NMC1000 driver
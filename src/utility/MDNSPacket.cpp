@@ -0,0 +1,146 @@
+/*
+  MDNSPacket.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __AVR__
+#include <strings.h>
+#endif
+
+#include "MDNSPacket.h"
+
+uint16_t mdnsGet16(const uint8_t* p)
+{
+	return ((uint16_t)p[0] << 8) | p[1];
+}
+
+uint32_t mdnsGet32(const uint8_t* p)
+{
+	return ((uint32_t)mdnsGet16(p) << 16) | mdnsGet16(p + 2);
+}
+
+uint8_t* mdnsPut16(uint8_t* p, uint16_t value)
+{
+	*p++ = value >> 8;
+	*p++ = value;
+	return p;
+}
+
+uint8_t* mdnsPut32(uint8_t* p, uint32_t value)
+{
+	p = mdnsPut16(p, value >> 16);
+	return mdnsPut16(p, value);
+}
+
+uint8_t* mdnsPutLabel(uint8_t* p, const char* label)
+{
+	uint8_t length = strlen(label);
+
+	*p++ = length;
+	memcpy(p, label, length);
+	return p + length;
+}
+
+uint8_t* mdnsPutName(uint8_t* p, const char* name)
+{
+	while (*name) {
+		const char* dot = strchr(name, '.');
+		uint8_t length = dot ? (dot - name) : strlen(name);
+
+		*p++ = length;
+		memcpy(p, name, length);
+		p += length;
+		name += length;
+		if (*name) {
+			name++;
+		}
+	}
+	*p++ = 0x00;
+
+	return p;
+}
+
+int mdnsReadName(const uint8_t* packet, int length, int offset, char* name, int size)
+{
+	int next = -1;
+	int jumps = 0;
+	int n = 0;
+	bool fits = true;
+
+	while (offset < length) {
+		uint8_t labelLength = packet[offset];
+
+		if ((labelLength & 0xC0) == 0xC0) {
+			// compression pointer
+			if (offset + 1 >= length || ++jumps > 8) {
+				return -1;
+			}
+			if (next < 0) {
+				next = offset + 2;
+			}
+			offset = ((labelLength & 0x3F) << 8) | packet[offset + 1];
+			continue;
+		}
+		if (labelLength & 0xC0) {
+			return -1;
+		}
+		offset++;
+
+		if (labelLength == 0) {
+			name[fits ? n : 0] = '\0';
+			return (next < 0) ? offset : next;
+		}
+		if (offset + labelLength > length) {
+			return -1;
+		}
+		if (n + labelLength + 2 > size) {
+			fits = false;
+		}
+		if (fits) {
+			if (n) {
+				name[n++] = '.';
+			}
+			memcpy(&name[n], &packet[offset], labelLength);
+			n += labelLength;
+		}
+		offset += labelLength;
+	}
+
+	return -1;
+}
+
+bool mdnsMatchName(const char* name, const char* a, const char* b, const char* c, const char* d)
+{
+	const char* labels[] = { a, b, c, d };
+
+	for (int i = 0; i < 4 && labels[i]; i++) {
+		size_t length = strlen(labels[i]);
+
+		if (i) {
+			if (*name != '.') {
+				return false;
+			}
+			name++;
+		}
+		if (strncasecmp(name, labels[i], length) != 0) {
+			return false;
+		}
+		name += length;
+	}
+
+	return *name == '\0';
+}
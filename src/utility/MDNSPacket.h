@@ -0,0 +1,59 @@
+/*
+  MDNSPacket.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MDNSPACKET_H
+#define MDNSPACKET_H
+
+#include <Arduino.h>
+
+// DNS wire format helpers shared by WiFiMDNSResponder and WiFiMDNS.
+
+#define MDNS_HEADER_SIZE 12
+#define MDNS_RECORD_SIZE 10
+#define MDNS_LABEL_MAX 63
+
+#define MDNS_TYPE_A 0x0001
+#define MDNS_TYPE_PTR 0x000C
+#define MDNS_TYPE_TXT 0x0010
+#define MDNS_TYPE_AAAA 0x001C
+#define MDNS_TYPE_SRV 0x0021
+#define MDNS_TYPE_NSEC 0x002F
+#define MDNS_TYPE_ANY 0x00FF
+
+#define MDNS_CLASS_IN 0x0001
+#define MDNS_CLASS_ANY 0x00FF
+#define MDNS_CLASS_FLUSH 0x8000
+
+#define MDNS_FLAG_RESPONSE 0x8000
+
+uint16_t mdnsGet16(const uint8_t* p);
+uint32_t mdnsGet32(const uint8_t* p);
+uint8_t* mdnsPut16(uint8_t* p, uint16_t value);
+uint8_t* mdnsPut32(uint8_t* p, uint32_t value);
+uint8_t* mdnsPutLabel(uint8_t* p, const char* label);
+// Dotted name as labels, with the terminating root label.
+uint8_t* mdnsPutName(uint8_t* p, const char* name);
+
+// Reads the name at offset as labels separated by dots, name is left empty
+// if it does not fit. Returns the offset after the name or -1.
+int mdnsReadName(const uint8_t* packet, int length, int offset, char* name, int size);
+// Case insensitive match of name against the labels a.b.c.d.
+bool mdnsMatchName(const char* name, const char* a, const char* b, const char* c = NULL, const char* d = NULL);
+
+#endif /* MDNSPACKET_H */
@@ -0,0 +1,87 @@
+/*
+  WiFiLed.cpp - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+extern "C" {
+	#include "driver/include/m2m_wifi.h"
+	#include "driver/include/m2m_periph.h"
+}
+
+#include "WiFiLed.h"
+
+#ifdef CONF_PERIPH
+
+WiFiLedClass::WiFiLedClass() :
+	_enabled(false),
+	_on(false),
+	_pending(false),
+	_active(0),
+	_interval(WIFI_LED_INTERVAL),
+	_lastUpdate(0)
+{
+}
+
+void WiFiLedClass::begin()
+{
+	// init() leaves the led off
+	_enabled = true;
+	_on = false;
+	_pending = false;
+	_active = 0;
+	_lastUpdate = millis();
+}
+
+void WiFiLedClass::end()
+{
+	if (_enabled && _on) {
+		set(false);
+	}
+	_enabled = false;
+}
+
+void WiFiLedClass::setInterval(unsigned long interval)
+{
+	_interval = interval;
+}
+
+void WiFiLedClass::update()
+{
+	if (!_enabled || millis() - _lastUpdate < _interval) {
+		return;
+	}
+
+	bool on = _pending || _active;
+
+	_pending = false;
+	if (on != _on) {
+		set(on);
+	}
+	_lastUpdate = millis();
+}
+
+void WiFiLedClass::set(bool on)
+{
+	// Network led (rev A then rev B), active low.
+	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, !on);
+	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, !on);
+	_on = on;
+}
+
+WiFiLedClass WiFiLed;
+
+#endif
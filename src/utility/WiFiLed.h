@@ -0,0 +1,57 @@
+/*
+  WiFiLed.h - Library for Arduino Wifi shield.
+  Copyright (c) 2011-2014 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WIFILED_H
+#define WIFILED_H
+
+#include <Arduino.h>
+
+#define WIFI_LED_INTERVAL (50u)
+
+// Network activity led. Activity is only recorded, the led itself is
+// updated from the event pump, at most once per interval.
+class WiFiLedClass {
+public:
+  WiFiLedClass();
+
+  void begin();
+  void end();
+  void setInterval(unsigned long interval);
+
+  // Blink for a short activity, or stay on between beginActivity() and endActivity().
+  void activity() { _pending = true; }
+  void beginActivity() { _active++; _pending = true; }
+  void endActivity() { if (_active) _active--; }
+
+  void update();
+
+private:
+  void set(bool on);
+
+  bool _enabled;
+  bool _on;
+  volatile bool _pending;
+  uint8_t _active;
+  unsigned long _interval;
+  unsigned long _lastUpdate;
+};
+
+extern WiFiLedClass WiFiLed;
+
+#endif /* WIFILED_H */
@@ -21,10 +21,10 @@ extern "C" {
 	#include "driver/include/m2m_wifi.h"
 	#include "socket/include/m2m_socket_host_if.h"
 	#include "driver/source/m2m_hif.h"
-	#include "driver/include/m2m_periph.h"
 }
 
 #include "WiFiSocket.h"
+#include "WiFiLed.h"
 
 #ifdef LIMITED_RAM_DEVICE
 #define SOCKET_BUFFER_SIZE 64
@@ -32,6 +32,9 @@ extern "C" {
 #define SOCKET_BUFFER_SIZE 1472
 #endif
 
+// how long waitSend() backs off when no send completes
+#define SEND_RETRY_INTERVAL 10
+
 extern uint8 hif_receive_blocked;
 
 enum {
@@ -51,12 +54,23 @@ WiFiSocketClass::WiFiSocketClass()
 	for (int i = 0; i < MAX_SOCKET; i++) {
 		_info[i].state = SOCKET_STATE_INVALID;
 		_info[i].parent = -1;
+		_info[i].ssl = 0;
 		_info[i].recvMsg.s16BufferSize = 0;
 		_info[i].buffer.data = NULL;
 		_info[i].buffer.head = NULL;
 		_info[i].buffer.length = 0;
+		_info[i].ahead.data = NULL;
+		_info[i].ahead.length = 0;
+		_info[i].receiveAhead = 0;
+		_info[i].peerClosed = 0;
+		_info[i].sendsPending = 0;
 		memset(&_info[i]._lastSendtoAddr, 0x00, sizeof(_info[i]._lastSendtoAddr));
 	}
+
+	_callDepth = 0;
+	_eventsHandled = 0;
+	_lastActivity = 0;
+	_cryptoLocked = 0;
 }
 
 WiFiSocketClass::~WiFiSocketClass()
@@ -65,11 +79,21 @@ WiFiSocketClass::~WiFiSocketClass()
 
 SOCKET WiFiSocketClass::create(uint16 u16Domain, uint8 u8Type, uint8 u8Flags)
 {
-	SOCKET sock = socket(u16Domain, u8Type, u8Flags);
+	SOCKET sock;
+
+	if ((u8Flags & SOCKET_FLAGS_SSL) && _cryptoLocked) {
+		return -1;
+	}
+
+	sock = socket(u16Domain, u8Type, u8Flags);
 
 	if (sock >= 0) {
 		_info[sock].state = SOCKET_STATE_IDLE;
 		_info[sock].parent = -1;
+		_info[sock].ssl = (u8Flags & SOCKET_FLAGS_SSL) ? 1 : 0;
+		_info[sock].receiveAhead = 0;
+		_info[sock].peerClosed = 0;
+		_info[sock].sendsPending = 0;
 	}
 
 	return sock;
@@ -161,68 +185,68 @@ sint8 WiFiSocketClass::connect(SOCKET sock, struct sockaddr *pstrAddr, uint8 u8A
 
 uint8 WiFiSocketClass::connected(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	return (_info[sock].state == SOCKET_STATE_CONNECTED);
 }
 
 uint8 WiFiSocketClass::listening(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	return (_info[sock].state == SOCKET_STATE_LISTENING);
 }
 
 uint8 WiFiSocketClass::bound(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	return (_info[sock].state == SOCKET_STATE_BOUND);
 }
 
 int WiFiSocketClass::available(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	if (_info[sock].state != SOCKET_STATE_CONNECTED && _info[sock].state != SOCKET_STATE_BOUND) {
 		return 0;
 	}
 
-	return (_info[sock].buffer.length + _info[sock].recvMsg.s16BufferSize);
+	return (_info[sock].buffer.length + _info[sock].ahead.length + _info[sock].recvMsg.s16BufferSize);
 }
 
 int WiFiSocketClass::peek(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
-
-	if (_info[sock].state != SOCKET_STATE_CONNECTED && _info[sock].state != SOCKET_STATE_BOUND) {
-		return -1;
-	}
+	beginCall();
+	handleEvents();
 
-	if (available(sock) == 0) {
-		return -1;
-	}
+	int result = -1;
 
-	if (_info[sock].buffer.length == 0 && _info[sock].recvMsg.s16BufferSize) {
-		if (!fillRecvBuffer(sock)) {
-			return -1;
+	if ((_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) && available(sock)) {
+		if (_info[sock].buffer.length || nextRecvBuffer(sock)) {
+			result = *_info[sock].buffer.head;
 		}
 	}
 
-	return *_info[sock].buffer.head;
+	endCall();
+
+	return result;
 }
 
 int WiFiSocketClass::read(SOCKET sock, uint8_t* buf, size_t size)
 {
-	m2m_wifi_handle_events(NULL);
+	beginCall();
+	handleEvents();
 
 	if (_info[sock].state != SOCKET_STATE_CONNECTED && _info[sock].state != SOCKET_STATE_BOUND) {
+		endCall();
 		return 0;
 	}
 
 	int avail = available(sock);
 
 	if (avail <= 0) {
+		endCall();
 		return 0;
 	}
 
@@ -233,8 +257,8 @@ int WiFiSocketClass::read(SOCKET sock, uint8_t* buf, size_t size)
 	int bytesRead = 0;
 
 	while (size) {
-		if (_info[sock].buffer.length == 0 && _info[sock].recvMsg.s16BufferSize) {
-			if (!fillRecvBuffer(sock)) {
+		if (_info[sock].buffer.length == 0) {
+			if (!nextRecvBuffer(sock)) {
 				break;
 			}
 		}
@@ -254,7 +278,226 @@ int WiFiSocketClass::read(SOCKET sock, uint8_t* buf, size_t size)
 		bytesRead += toCopy;
 	}
 
-	if (_info[sock].buffer.length == 0 && _info[sock].recvMsg.s16BufferSize == 0) {
+	updateRecv(sock);
+
+	endCall();
+
+	return bytesRead;
+}
+
+const uint8_t* WiFiSocketClass::recvSpan(SOCKET sock, int* length)
+{
+	beginCall();
+	handleEvents();
+
+	*length = 0;
+
+	if (_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) {
+		if (_info[sock].buffer.length || nextRecvBuffer(sock)) {
+			*length = _info[sock].buffer.length;
+		}
+	}
+
+	endCall();
+
+	return (*length) ? _info[sock].buffer.head : NULL;
+}
+
+void WiFiSocketClass::consume(SOCKET sock, int length)
+{
+	if (length > _info[sock].buffer.length) {
+		length = _info[sock].buffer.length;
+	}
+
+	_info[sock].buffer.head += length;
+	_info[sock].buffer.length -= length;
+
+	updateRecv(sock);
+}
+
+int WiFiSocketClass::peekBytes(SOCKET sock, uint8_t* buf, size_t size)
+{
+	beginCall();
+	handleEvents();
+
+	int bytesPeeked = 0;
+
+	if (_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) {
+		if (_info[sock].buffer.length == 0) {
+			nextRecvBuffer(sock);
+		}
+
+		// extend the window into the spare buffer when the data straddles two chunks
+		if ((size_t)_info[sock].buffer.length < size && _info[sock].ahead.length == 0 && _info[sock].recvMsg.s16BufferSize) {
+			fillAheadBuffer(sock);
+		}
+
+		int toCopy = min(size, (size_t)_info[sock].buffer.length);
+
+		memcpy(buf, _info[sock].buffer.head, toCopy);
+		bytesPeeked += toCopy;
+
+		toCopy = min(size - bytesPeeked, (size_t)_info[sock].ahead.length);
+
+		memcpy(buf + bytesPeeked, _info[sock].ahead.data, toCopy);
+		bytesPeeked += toCopy;
+	}
+
+	endCall();
+
+	return bytesPeeked;
+}
+
+int WiFiSocketClass::skip(SOCKET sock, size_t size)
+{
+	const uint8_t* span;
+	int length;
+	int skipped = 0;
+
+	beginCall();
+
+	while (size && (span = recvSpan(sock, &length)) != NULL) {
+		if ((size_t)length > size) {
+			length = size;
+		}
+
+		consume(sock, length);
+		size -= length;
+		skipped += length;
+	}
+
+	endCall();
+
+	return skipped;
+}
+
+void WiFiSocketClass::discard(SOCKET sock)
+{
+	beginCall();
+	handleEvents();
+
+	if (_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) {
+		_info[sock].buffer.head = _info[sock].buffer.data;
+		_info[sock].buffer.length = 0;
+		_info[sock].ahead.length = 0;
+
+		if (_info[sock].recvMsg.s16BufferSize > 0) {
+			_info[sock].recvMsg.s16BufferSize = 0;
+
+			// drop what is left in the module in one go
+			hif_receive(0, NULL, 0, 1);
+		}
+
+		updateRecv(sock);
+	}
+
+	endCall();
+}
+
+int WiFiSocketClass::readUntil(SOCKET sock, uint8_t terminator, uint8_t* buf, size_t size, uint8_t* found)
+{
+	const uint8_t* span;
+	int length;
+	int bytesRead = 0;
+
+	*found = 0;
+
+	beginCall();
+
+	while (size && (span = recvSpan(sock, &length)) != NULL) {
+		if ((size_t)length > size) {
+			length = size;
+		}
+
+		const uint8_t* end = (const uint8_t*)memchr(span, terminator, length);
+
+		if (end != NULL) {
+			length = end - span;
+		}
+
+		memcpy(buf, span, length);
+		buf += length;
+		size -= length;
+		bytesRead += length;
+
+		if (end != NULL) {
+			// drop the terminator as well
+			consume(sock, length + 1);
+			*found = 1;
+			break;
+		}
+
+		consume(sock, length);
+	}
+
+	endCall();
+
+	return bytesRead;
+}
+
+int WiFiSocketClass::find(SOCKET sock, const uint8_t* target, size_t length, size_t* matched, size_t limit)
+{
+	const uint8_t* span;
+	int spanLength;
+	int consumed = 0;
+
+	beginCall();
+
+	while (*matched < length && limit && (span = recvSpan(sock, &spanLength)) != NULL) {
+		size_t i = 0;
+
+		if ((size_t)spanLength > limit) {
+			spanLength = limit;
+		}
+
+		while (i < (size_t)spanLength && *matched < length) {
+			if (*matched == 0) {
+				// skip straight to the next candidate start
+				const uint8_t* start = (const uint8_t*)memchr(span + i, target[0], spanLength - i);
+
+				if (start == NULL) {
+					i = spanLength;
+					break;
+				}
+
+				i = (start - span) + 1;
+				*matched = 1;
+			} else if (span[i] == target[*matched]) {
+				i++;
+				(*matched)++;
+			} else {
+				// fall back to the longest prefix of target that still matches
+				size_t j = *matched;
+
+				while (j > 0 && (target[j - 1] != span[i] || memcmp(target, target + *matched - j + 1, j - 1) != 0)) {
+					j--;
+				}
+
+				*matched = j;
+				i++;
+			}
+		}
+
+		consume(sock, i);
+		consumed += i;
+		limit -= i;
+	}
+
+	endCall();
+
+	return consumed;
+}
+
+void WiFiSocketClass::updateRecv(SOCKET sock)
+{
+	if (_info[sock].buffer.length == 0 && _info[sock].ahead.length) {
+		// data must be delivered in order, move the spare buffer in first
+		nextRecvBuffer(sock);
+	}
+
+	if (_info[sock].receiveAhead) {
+		receiveAhead(sock);
+	} else if (_info[sock].buffer.length == 0 && _info[sock].recvMsg.s16BufferSize == 0) {
 		if (sock < TCP_SOCK_MAX) {
 			// TCP
 			recv(sock, NULL, 0, 0);
@@ -262,10 +505,13 @@ int WiFiSocketClass::read(SOCKET sock, uint8_t* buf, size_t size)
 			// UDP
 			recvfrom(sock, NULL, 0, 0);
 		}
-		m2m_wifi_handle_events(NULL);
+		handleEvents();
 	}
 
-	return bytesRead;
+	if (_info[sock].peerClosed && available(sock) == 0) {
+		// remote end closed while data was still buffered ahead
+		close(sock);
+	}
 }
 
 IPAddress WiFiSocketClass::remoteIP(SOCKET sock)
@@ -280,16 +526,16 @@ uint16_t WiFiSocketClass::remotePort(SOCKET sock)
 
 size_t WiFiSocketClass::write(SOCKET sock, const uint8_t *buf, size_t size)
 {
-	m2m_wifi_handle_events(NULL);
+	// recorded first, so the power save policy run by the event pump sees it
+	_lastActivity = millis();
+	handleEvents();
 
 	if (_info[sock].state != SOCKET_STATE_CONNECTED) {
 		return 0;
 	}
 
 #ifdef CONF_PERIPH
-	// Network led ON (rev A then rev B).
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 0);
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 0);
+	WiFiLed.activity();
 #endif
 
 	sint16 err;
@@ -306,18 +552,70 @@ size_t WiFiSocketClass::write(SOCKET sock, const uint8_t *buf, size_t size)
 		m2m_wifi_handle_events(NULL);
 	}
 
+	if (size && _info[sock].sendsPending < 0xff) {
+		_info[sock].sendsPending++;
+	}
+
+	_lastActivity = millis();
+
+	return size;
+}
+
+sint16 WiFiSocketClass::trySend(SOCKET sock, const uint8_t *buf, uint16 size)
+{
+	if (_info[sock].state != SOCKET_STATE_CONNECTED) {
+		return SOCK_ERR_CONN_ABORTED;
+	}
+
 #ifdef CONF_PERIPH
-	// Network led OFF (rev A then rev B).
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-	m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
+	WiFiLed.activity();
 #endif
 
-	return size;
+	sint16 err = send(sock, (void *)buf, size, 0);
+
+	if (err == SOCK_ERR_NO_ERROR && _info[sock].sendsPending < 0xff) {
+		_info[sock].sendsPending++;
+	}
+
+	_lastActivity = millis();
+
+	return err;
+}
+
+int WiFiSocketClass::waitSend(SOCKET sock, unsigned long timeout)
+{
+	uint8_t pending = _info[sock].sendsPending;
+	unsigned long start = millis();
+
+	// Wait for one of the outstanding sends to complete, so that the next
+	// attempt does not poll the module for a buffer it does not have yet.
+	// With nothing outstanding (the peer window is full) just back off.
+	for (;;) {
+		if (hif_receive_blocked || _info[sock].state != SOCKET_STATE_CONNECTED) {
+			return 0;
+		}
+
+		m2m_wifi_handle_events(NULL);
+
+		if (_info[sock].sendsPending < pending) {
+			return 1;
+		}
+
+		unsigned long elapsed = millis() - start;
+
+		if (elapsed >= timeout) {
+			return 0;
+		}
+		if (elapsed >= SEND_RETRY_INTERVAL) {
+			return 1;
+		}
+	}
 }
 
 sint16 WiFiSocketClass::sendto(SOCKET sock, void *pvSendBuffer, uint16 u16SendLength, uint16 flags, struct sockaddr *pstrDestAddr, uint8 u8AddrLen)
 {
-	m2m_wifi_handle_events(NULL);
+	_lastActivity = millis();
+	handleEvents();
 
 	if (_info[sock].state != SOCKET_STATE_BOUND) {
 		return -1;
@@ -334,7 +632,7 @@ sint16 WiFiSocketClass::sendto(SOCKET sock, void *pvSendBuffer, uint16 u16SendLe
 
 sint8 WiFiSocketClass::close(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	if (_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) {
 		if (_info[sock].recvMsg.s16BufferSize > 0) {
@@ -347,6 +645,7 @@ sint8 WiFiSocketClass::close(SOCKET sock)
 
 	_info[sock].state = SOCKET_STATE_INVALID;
 	_info[sock].parent = -1;
+	_info[sock].ssl = 0;
 
 	if (_info[sock].buffer.data != NULL) {
 		free(_info[sock].buffer.data);
@@ -354,6 +653,14 @@ sint8 WiFiSocketClass::close(SOCKET sock)
 	_info[sock].buffer.data = NULL;
 	_info[sock].buffer.head = NULL;
 	_info[sock].buffer.length = 0;
+	if (_info[sock].ahead.data != NULL) {
+		free(_info[sock].ahead.data);
+	}
+	_info[sock].ahead.data = NULL;
+	_info[sock].ahead.length = 0;
+	_info[sock].receiveAhead = 0;
+	_info[sock].peerClosed = 0;
+	_info[sock].sendsPending = 0;
 	_info[sock].recvMsg.s16BufferSize = 0;
 	memset(&_info[sock]._lastSendtoAddr, 0x00, sizeof(_info[sock]._lastSendtoAddr));
 
@@ -369,9 +676,27 @@ int WiFiSocketClass::hasParent(SOCKET sock, SOCKET child)
 	return 1;
 }
 
+uint8_t WiFiSocketClass::setReceiveAhead(SOCKET sock, uint8_t enable)
+{
+	uint8_t previous = _info[sock].receiveAhead;
+
+	if (sock >= TCP_SOCK_MAX) {
+		// UDP datagrams must stay separate, receive-ahead is TCP only
+		return previous;
+	}
+
+	_info[sock].receiveAhead = enable;
+
+	if (enable && _info[sock].state == SOCKET_STATE_CONNECTED) {
+		receiveAhead(sock);
+	}
+
+	return previous;
+}
+
 SOCKET WiFiSocketClass::accepted(SOCKET sock)
 {
-	m2m_wifi_handle_events(NULL);
+	handleEvents();
 
 	for (SOCKET s = 0; s < TCP_SOCK_MAX; s++) {
 		if (_info[s].parent == sock && _info[s].state == SOCKET_STATE_ACCEPTED) {
@@ -387,13 +712,84 @@ SOCKET WiFiSocketClass::accepted(SOCKET sock)
 	return -1;
 }
 
+void WiFiSocketClass::handleEvents()
+{
+	if (_callDepth && _eventsHandled) {
+		// already serviced during this call, nothing to block on
+		return;
+	}
+
+	m2m_wifi_handle_events(NULL);
+
+	if (_callDepth) {
+		_eventsHandled = 1;
+	}
+}
+
+void WiFiSocketClass::beginCall()
+{
+	_callDepth++;
+}
+
+void WiFiSocketClass::endCall()
+{
+	if (_callDepth && --_callDepth == 0) {
+		_eventsHandled = 0;
+	}
+}
+
 void WiFiSocketClass::eventCallback(SOCKET sock, uint8 u8Msg, void *pvMsg)
 {
 	WiFiSocket.handleEvent(sock, u8Msg, pvMsg);
 }
 
+unsigned long WiFiSocketClass::lastActivity()
+{
+	return _lastActivity;
+}
+
+int WiFiSocketClass::busy()
+{
+	// Sends still in flight. Unread data does not count, a socket nobody
+	// reads would otherwise keep the module out of power save for good.
+	for (int i = 0; i < MAX_SOCKET; i++) {
+		if (_info[i].state == SOCKET_STATE_INVALID) {
+			continue;
+		}
+
+		if (_info[i].sendsPending) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int WiFiSocketClass::lockCrypto()
+{
+	if (_cryptoLocked) {
+		return 0;
+	}
+
+	for (int i = 0; i < MAX_SOCKET; i++) {
+		if (_info[i].state != SOCKET_STATE_INVALID && _info[i].ssl) {
+			return 0;
+		}
+	}
+
+	_cryptoLocked = 1;
+	return 1;
+}
+
+void WiFiSocketClass::unlockCrypto()
+{
+	_cryptoLocked = 0;
+}
+
 void WiFiSocketClass::handleEvent(SOCKET sock, uint8 u8Msg, void *pvMsg)
 {
+	_lastActivity = millis();
+
 	switch (u8Msg) {
 		/* Socket bind. */
 		case SOCKET_MSG_BIND: {
@@ -426,6 +822,7 @@ void WiFiSocketClass::handleEvent(SOCKET sock, uint8 u8Msg, void *pvMsg)
 			if (pstrAccept && pstrAccept->sock > -1) {
 				_info[pstrAccept->sock].state = SOCKET_STATE_ACCEPTED;
 				_info[pstrAccept->sock].parent = sock;
+				_info[pstrAccept->sock].ssl = _info[sock].ssl;
 				_info[pstrAccept->sock].recvMsg.strRemoteAddr = pstrAccept->strAddr;
 			}
 		}
@@ -449,13 +846,16 @@ void WiFiSocketClass::handleEvent(SOCKET sock, uint8 u8Msg, void *pvMsg)
 			tstrSocketRecvMsg *pstrRecvMsg = (tstrSocketRecvMsg *)pvMsg;
 
 #ifdef CONF_PERIPH
-			// Network led ON (rev A then rev B).
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 0);
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 0);
+			WiFiLed.activity();
 #endif
 
 			if (pstrRecvMsg->s16BufferSize <= 0) {
-				close(sock);
+				if (_info[sock].buffer.length || _info[sock].ahead.length) {
+					// let the application drain the data received ahead first
+					_info[sock].peerClosed = 1;
+				} else {
+					close(sock);
+				}
 			} else if (_info[sock].state == SOCKET_STATE_CONNECTED || _info[sock].state == SOCKET_STATE_BOUND) {
 				_info[sock].recvMsg.pu8Buffer = pstrRecvMsg->pu8Buffer;
 				_info[sock].recvMsg.s16BufferSize = pstrRecvMsg->s16BufferSize;
@@ -466,23 +866,26 @@ void WiFiSocketClass::handleEvent(SOCKET sock, uint8 u8Msg, void *pvMsg)
 					_info[sock].recvMsg.strRemoteAddr = pstrRecvMsg->strRemoteAddr;
 				}
 
-				fillRecvBuffer(sock);
+				if (_info[sock].buffer.length == 0) {
+					fillRecvBuffer(sock);
+				}
+
+				if (_info[sock].receiveAhead) {
+					receiveAhead(sock);
+				}
 			} else {
 				// not connected or bound, discard data
 				hif_receive(0, NULL, 0, 1);
 			}
-
-#ifdef CONF_PERIPH
-			// Network led OFF (rev A then rev B).
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO16, 1);
-			m2m_periph_gpio_set_val(M2M_PERIPH_GPIO5, 1);
-#endif
 		}
 		break;
 
 		/* Socket data sent. */
 		case SOCKET_MSG_SEND: {
 			// sint16 *s16Sent = (sint16 *)pvMsg;
+			if (_info[sock].sendsPending) {
+				_info[sock].sendsPending--;
+			}
 		}
 		break;
 
@@ -499,6 +902,64 @@ int WiFiSocketClass::fillRecvBuffer(SOCKET sock)
 		_info[sock].buffer.length = 0;
 	}
 
+	int size = receiveData(sock, _info[sock].buffer.data);
+
+	if (size < 0) {
+		return 0;
+	}
+
+	_info[sock].buffer.head = _info[sock].buffer.data;
+	_info[sock].buffer.length = size;
+
+	return 1;
+}
+
+int WiFiSocketClass::fillAheadBuffer(SOCKET sock)
+{
+	if (_info[sock].ahead.data == NULL) {
+		_info[sock].ahead.data = (uint8_t*)malloc(SOCKET_BUFFER_SIZE);
+		_info[sock].ahead.length = 0;
+
+		if (_info[sock].ahead.data == NULL) {
+			return 0;
+		}
+	}
+
+	int size = receiveData(sock, _info[sock].ahead.data);
+
+	if (size < 0) {
+		return 0;
+	}
+
+	_info[sock].ahead.length = size;
+
+	return 1;
+}
+
+int WiFiSocketClass::nextRecvBuffer(SOCKET sock)
+{
+	if (_info[sock].ahead.length) {
+		// swap in the data that was received ahead
+		uint8_t* data = _info[sock].buffer.data;
+
+		_info[sock].buffer.data = _info[sock].ahead.data;
+		_info[sock].buffer.head = _info[sock].buffer.data;
+		_info[sock].buffer.length = _info[sock].ahead.length;
+		_info[sock].ahead.data = data;
+		_info[sock].ahead.length = 0;
+
+		return 1;
+	}
+
+	if (_info[sock].recvMsg.s16BufferSize) {
+		return fillRecvBuffer(sock);
+	}
+
+	return 0;
+}
+
+int WiFiSocketClass::receiveData(SOCKET sock, uint8_t* data)
+{
 	int size = _info[sock].recvMsg.s16BufferSize;
 
 	if (size > SOCKET_BUFFER_SIZE) {
@@ -507,16 +968,32 @@ int WiFiSocketClass::fillRecvBuffer(SOCKET sock)
 
 	uint8 lastTransfer = ((sint16)size == _info[sock].recvMsg.s16BufferSize);
 
-	if (hif_receive(_info[sock].recvMsg.pu8Buffer, _info[sock].buffer.data, (sint16)size, lastTransfer) != M2M_SUCCESS) {
-		return 0;
+	if (hif_receive(_info[sock].recvMsg.pu8Buffer, data, (sint16)size, lastTransfer) != M2M_SUCCESS) {
+		return -1;
 	}
 
-	_info[sock].buffer.head = _info[sock].buffer.data;
-	_info[sock].buffer.length = size;
 	_info[sock].recvMsg.pu8Buffer += size;
 	_info[sock].recvMsg.s16BufferSize -= size;
 
-	return 1;
+	return size;
+}
+
+void WiFiSocketClass::receiveAhead(SOCKET sock)
+{
+	if (_info[sock].buffer.length == 0) {
+		nextRecvBuffer(sock);
+	}
+
+	// pull pending data out of the module into the spare buffer,
+	// this releases the HIF once the whole segment has been read
+	if (_info[sock].buffer.length && _info[sock].ahead.length == 0 && _info[sock].recvMsg.s16BufferSize) {
+		fillAheadBuffer(sock);
+	}
+
+	// re-arm as soon as there is room for one more segment
+	if (_info[sock].ahead.length == 0 && _info[sock].recvMsg.s16BufferSize == 0 && !_info[sock].peerClosed) {
+		recv(sock, NULL, 0, 0);
+	}
 }
 
 WiFiSocketClass WiFiSocket;
@@ -44,30 +44,71 @@ public:
   int available(SOCKET sock);
   int peek(SOCKET sock);
   int read(SOCKET sock, uint8_t* buf, size_t size);
+  const uint8_t* recvSpan(SOCKET sock, int* length);
+  void consume(SOCKET sock, int length);
+  int peekBytes(SOCKET sock, uint8_t* buf, size_t size);
+  int skip(SOCKET sock, size_t size);
+  void discard(SOCKET sock);
+  int readUntil(SOCKET sock, uint8_t terminator, uint8_t* buf, size_t size, uint8_t* found);
+  int find(SOCKET sock, const uint8_t* target, size_t length, size_t* matched, size_t limit);
   size_t write(SOCKET sock, const uint8_t *buf, size_t size);
+  sint16 trySend(SOCKET sock, const uint8_t *buf, uint16 size);
+  int waitSend(SOCKET sock, unsigned long timeout);
   sint16 sendto(SOCKET sock, void *pvSendBuffer, uint16 u16SendLength, uint16 flags, struct sockaddr *pstrDestAddr, uint8 u8AddrLen);
   IPAddress remoteIP(SOCKET sock);
   uint16_t remotePort(SOCKET sock);
   sint8 close(SOCKET sock);
   SOCKET accepted(SOCKET sock);
   int hasParent(SOCKET sock, SOCKET child);
+  uint8_t setReceiveAhead(SOCKET sock, uint8_t enable);
+  unsigned long lastActivity();
+  int busy();
+
+  // The module's TLS uses the same crypto engine as host hashing, so the
+  // engine can only be locked while no SSL socket is open, and SSL sockets
+  // cannot be created while it is locked.
+  int lockCrypto();
+  void unlockCrypto();
+
+  // Service pending HIF events, at most once per outermost beginCall()/endCall() pair.
+  void handleEvents();
+  void beginCall();
+  void endCall();
 
   static void eventCallback(SOCKET sock, uint8 u8Msg, void *pvMsg);
 
 private:
   void handleEvent(SOCKET sock, uint8 u8Msg, void *pvMsg);
   int fillRecvBuffer(SOCKET sock);
+  int fillAheadBuffer(SOCKET sock);
+  int nextRecvBuffer(SOCKET sock);
+  int receiveData(SOCKET sock, uint8_t* data);
+  void receiveAhead(SOCKET sock);
+  void updateRecv(SOCKET sock);
+
+  uint8_t _callDepth;
+  uint8_t _eventsHandled;
+  unsigned long _lastActivity;
+  uint8_t _cryptoLocked;
 
   struct 
   {
     uint8_t state;
     SOCKET parent;
+    uint8_t ssl;
     tstrSocketRecvMsg recvMsg;
     struct {
       uint8_t* data;
       uint8_t* head;
       int length;
     } buffer;
+    struct {
+      uint8_t* data;
+      int length;
+    } ahead;
+    uint8_t receiveAhead;
+    uint8_t peerClosed;
+    uint8_t sendsPending;
     struct sockaddr _lastSendtoAddr;
   } _info[MAX_SOCKET];
 };